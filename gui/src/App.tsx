@@ -14,7 +14,7 @@ export interface Level {
 export interface Trade {
   price: number;
   qty: number;
-  maker: number;
+  makers: number;
   taker: number;
   timestamp?: number;
 }
@@ -0,0 +1,47 @@
+#include "Clock.hpp"
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define OME_HAVE_RDTSC 1
+#endif
+
+namespace ome {
+
+namespace {
+
+uint64_t readTicks() {
+#ifdef OME_HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+TscClock::TscClock(std::chrono::milliseconds calibration)
+    : base(std::chrono::system_clock::now()), baseTicks(readTicks()), nanosPerTick(0.0) {
+#ifdef OME_HAVE_RDTSC
+    std::this_thread::sleep_for(calibration);
+    auto end = std::chrono::system_clock::now();
+    uint64_t endTicks = readTicks();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - base).count();
+    if (endTicks > baseTicks && elapsed > 0) {
+        nanosPerTick = static_cast<double>(elapsed) / static_cast<double>(endTicks - baseTicks);
+    }
+#else
+    (void)calibration;
+#endif
+}
+
+Timestamp TscClock::now() {
+    if (nanosPerTick == 0.0) {
+        return std::chrono::system_clock::now();
+    }
+    auto nanos = static_cast<int64_t>(static_cast<double>(readTicks() - baseTicks) * nanosPerTick);
+    return base + std::chrono::duration_cast<Timestamp::duration>(std::chrono::nanoseconds(nanos));
+}
+
+} // namespace ome
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ome {
+
+using Timestamp = std::chrono::system_clock::time_point;
+
+// Time source for the engine. The engine samples it once per command and
+// stamps every order, trade and expiry that command produces with that value,
+// so the hot path never reads the clock per event.
+class EngineClock {
+public:
+    virtual ~EngineClock() = default;
+    virtual Timestamp now() = 0;
+};
+
+// Wall clock via system_clock (a vDSO call per sample)
+class SystemClock : public EngineClock {
+public:
+    Timestamp now() override { return std::chrono::system_clock::now(); }
+};
+
+// Wall clock extrapolated from the CPU timestamp counter, calibrated against
+// system_clock at construction. Assumes an invariant TSC; on targets without
+// rdtsc it falls back to system_clock.
+class TscClock : public EngineClock {
+public:
+    explicit TscClock(std::chrono::milliseconds calibration = std::chrono::milliseconds(20));
+    Timestamp now() override;
+    // Calibrated rate; 0 if there is no TSC and now() is system_clock
+    double nanosecondsPerTick() const { return nanosPerTick; }
+
+private:
+    Timestamp base;
+    uint64_t baseTicks;
+    double nanosPerTick;
+};
+
+// Deterministic clock for replay and tests: time only moves when told to
+class SimulatedClock : public EngineClock {
+public:
+    explicit SimulatedClock(Timestamp start = Timestamp{}) : nanos(start.time_since_epoch().count()) {}
+
+    Timestamp now() override { return Timestamp(Timestamp::duration(nanos.load(std::memory_order_acquire))); }
+    void set(Timestamp t) { nanos.store(t.time_since_epoch().count(), std::memory_order_release); }
+    void advance(Timestamp::duration d) { nanos.fetch_add(d.count(), std::memory_order_acq_rel); }
+
+private:
+    std::atomic<Timestamp::rep> nanos;
+};
+
+} // namespace ome
@@ -0,0 +1,118 @@
+#include "Latency.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace ome {
+
+const char* toString(LatencyStage stage) {
+    switch (stage) {
+    case LatencyStage::Parse:   return "parse";
+    case LatencyStage::Queue:   return "queue";
+    case LatencyStage::Match:   return "match";
+    case LatencyStage::Publish: return "publish";
+    case LatencyStage::Send:    return "send";
+    case LatencyStage::Total:   return "total";
+    }
+    return "unknown";
+}
+
+uint64_t LatencyHistogram::highestIn(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    const unsigned shift = static_cast<unsigned>(bucket / kHalf) - 1;
+    const uint64_t lowest = (kHalf + bucket % kHalf) << shift;
+    return lowest + ((uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBuckets; ++i) {
+        uint64_t n = other.counts[i].load(std::memory_order_relaxed);
+        if (n) counts[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    sum.fetch_add(other.total(), std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t n = 0;
+    for (const auto& c : counts) n += c.load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64_t LatencyHistogram::quantile(double q) const {
+    const uint64_t n = count();
+    if (n == 0) return 0;
+    // Nearest rank
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(n))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return highestIn(i);
+    }
+    return highestIn(kBuckets - 1);
+}
+
+LatencyRecorder::LatencyRecorder(std::chrono::milliseconds calibration) {
+#if defined(__x86_64__) || defined(__i386__)
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startTicks = latencyTicks();
+    std::this_thread::sleep_for(calibration);
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    uint64_t ticks = latencyTicks() - startTicks;
+    if (ticks > 0 && elapsed > 0) {
+        nanosPerTick = static_cast<double>(elapsed) / static_cast<double>(ticks);
+    }
+#else
+    (void)calibration;
+#endif
+}
+
+std::array<LatencySummary, kLatencyStages> LatencyRecorder::summary() const {
+    auto merged = std::make_unique<Shard>();
+    shards.forEach([&merged](const Shard& shard) {
+        for (size_t s = 0; s < kLatencyStages; ++s) {
+            merged->stages[s].merge(shard.stages[s]);
+        }
+    });
+
+    auto toNanos = [this](uint64_t ticks) {
+        return static_cast<uint64_t>(std::llround(static_cast<double>(ticks) * nanosPerTick));
+    };
+    std::array<LatencySummary, kLatencyStages> result;
+    for (size_t s = 0; s < kLatencyStages; ++s) {
+        const LatencyHistogram& h = merged->stages[s];
+        LatencySummary& out = result[s];
+        out.count = h.count();
+        if (out.count == 0) continue;
+        out.mean = static_cast<double>(h.total()) * nanosPerTick / static_cast<double>(out.count);
+        out.p50 = toNanos(h.quantile(0.50));
+        out.p90 = toNanos(h.quantile(0.90));
+        out.p99 = toNanos(h.quantile(0.99));
+        out.p999 = toNanos(h.quantile(0.999));
+        out.p9999 = toNanos(h.quantile(0.9999));
+        out.max = toNanos(h.quantile(1.0));
+    }
+    return result;
+}
+
+std::string LatencyRecorder::report() const {
+    auto stages = summary();
+    std::string out;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-8s %10s %9s %9s %9s %9s %9s %9s %9s\n",
+                  "stage", "count", "mean", "p50", "p90", "p99", "p99.9", "p99.99", "max");
+    out += line;
+    for (size_t s = 0; s < kLatencyStages; ++s) {
+        const LatencySummary& l = stages[s];
+        std::snprintf(line, sizeof(line), "%-8s %10llu %9.0f %9llu %9llu %9llu %9llu %9llu %9llu\n",
+                      toString(static_cast<LatencyStage>(s)), static_cast<unsigned long long>(l.count), l.mean,
+                      static_cast<unsigned long long>(l.p50), static_cast<unsigned long long>(l.p90),
+                      static_cast<unsigned long long>(l.p99), static_cast<unsigned long long>(l.p999),
+                      static_cast<unsigned long long>(l.p9999), static_cast<unsigned long long>(l.max));
+        out += line;
+    }
+    return out;
+}
+
+} // namespace ome
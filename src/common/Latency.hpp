@@ -0,0 +1,144 @@
+#pragma once
+
+#include "PerThread.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace ome {
+
+// Raw stamp for latency measurement: the CPU timestamp counter where there
+// is one (assumed invariant and in step across cores, as for TscClock),
+// steady_clock nanoseconds elsewhere. LatencyRecorder converts to ns.
+inline uint64_t latencyTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Intervals between the stamps a command collects on its way through the
+// server and engine
+enum class LatencyStage : uint8_t {
+    Parse,      // Frame received -> engine queue (throttle, JSON, risk)
+    Queue,      // Queued -> engine starts on it
+    Match,      // Journal, replication and the book operation
+    Publish,    // Matched -> handed to a callback (trade broadcast first, Sync durability)
+    Send,       // Handed over -> written to the sockets
+    Total       // Frame received -> written to the sockets
+};
+constexpr size_t kLatencyStages = 6;
+
+const char* toString(LatencyStage stage);
+
+// Stamps carried with a command (0 = not stamped)
+struct LatencyStamps {
+    uint64_t ingress = 0;
+    uint64_t enqueue = 0;
+    uint64_t dequeue = 0;
+    uint64_t matched = 0;
+    uint64_t published = 0;
+};
+
+// The stamps of the command being handled on this thread, for code further
+// down the call chain: set by the server around a frame (ingress only) and by
+// the engine around each callback it makes for a command.
+class LatencyScope {
+public:
+    explicit LatencyScope(const LatencyStamps* stamps) : previous(active) { active = stamps; }
+    ~LatencyScope() { active = previous; }
+    LatencyScope(const LatencyScope&) = delete;
+    LatencyScope& operator=(const LatencyScope&) = delete;
+
+    static const LatencyStamps* current() { return active; }
+
+private:
+    static inline thread_local const LatencyStamps* active = nullptr;
+    const LatencyStamps* previous;
+};
+
+// HDR-style log-linear histogram: exact below 2^kSubBucketBits, then 64
+// linear sub-buckets per power of two (under 1.6% relative error) up to the
+// full 64-bit range. Recording is single-writer: relaxed loads and stores,
+// no locked instructions. Others may merge it at any time.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 7;
+    static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+    static constexpr uint64_t kHalf = kSubBuckets / 2;
+    static constexpr size_t kBuckets = (64 - kSubBucketBits + 1) * kHalf + kHalf;
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < kSubBuckets) return static_cast<size_t>(value);
+        const unsigned shift = 63 - static_cast<unsigned>(__builtin_clzll(value)) - (kSubBucketBits - 1);
+        return static_cast<size_t>(shift * kHalf + (value >> shift));
+    }
+    // Largest value that lands in the bucket
+    static uint64_t highestIn(size_t bucket);
+
+    void record(uint64_t value) {
+        auto& slot = counts[bucketOf(value)];
+        slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // Adds another histogram's counts (it may be recording meanwhile)
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const;
+    uint64_t total() const { return sum.load(std::memory_order_relaxed); }
+    // Highest value equivalent to the q-th quantile, q in [0, 1]; 0 if empty
+    uint64_t quantile(double q) const;
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts{};
+    std::atomic<uint64_t> sum{0};
+};
+
+struct LatencySummary {
+    uint64_t count = 0;
+    double mean = 0;    // Nanoseconds, as are the rest
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t p9999 = 0;
+    uint64_t max = 0;
+};
+
+// One histogram per stage per recording thread (see PerThread), merged on
+// demand, so record() takes no lock after the thread's first call
+class LatencyRecorder {
+public:
+    // Calibrates ticks against steady_clock (blocks for `calibration`)
+    explicit LatencyRecorder(std::chrono::milliseconds calibration = std::chrono::milliseconds(20));
+
+    // Interval between two stamps; skipped if either is missing
+    void record(LatencyStage stage, uint64_t fromTicks, uint64_t toTicks) {
+        if (fromTicks == 0 || toTicks == 0) return;
+        shards.local().stages[static_cast<size_t>(stage)].record(toTicks > fromTicks ? toTicks - fromTicks : 0);
+    }
+
+    // All threads merged, in nanoseconds
+    std::array<LatencySummary, kLatencyStages> summary() const;
+    // Human-readable table of summary()
+    std::string report() const;
+
+private:
+    struct Shard {
+        std::array<LatencyHistogram, kLatencyStages> stages;
+    };
+
+    double nanosPerTick = 1.0;
+    PerThread<Shard> shards;
+};
+
+} // namespace ome
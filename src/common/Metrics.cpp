@@ -0,0 +1,34 @@
+#include "Metrics.hpp"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace ome {
+
+AllocatorStats allocatorStats() {
+    AllocatorStats stats;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = ::mallinfo2();
+    stats.available = true;
+    stats.arenaBytes = info.arena;
+    stats.inUseBytes = info.uordblks + info.hblkhd;
+    stats.freeBytes = info.fordblks;
+    stats.mmapBytes = info.hblkhd;
+#endif
+    return stats;
+}
+
+uint64_t Metrics::get(Counter counter) const {
+    uint64_t total = 0;
+    shards.forEach([&total, counter](const Shard& shard) {
+        total += shard.counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    });
+    return total;
+}
+
+void Metrics::batchSizes(LatencyHistogram& into) const {
+    shards.forEach([&into](const Shard& shard) { into.merge(shard.batchSizes); });
+}
+
+} // namespace ome
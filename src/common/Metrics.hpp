@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Latency.hpp"
+#include "PerThread.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ome {
+
+enum class Counter : uint8_t {
+    MessagesReceived,   // Frames, before throttling
+    BytesReceived,
+    Rejects,            // Refused by the server (throttle, risk, bad id)
+    Commands,           // Sequenced by the engine, expiry sweeps included
+    Orders,             // Add commands
+    Cancels,            // Orders named by cancel and bulk cancel commands
+    Modifies,
+    MassCancels,
+    Trades,             // Fills, one per maker
+    TradedQuantity,
+    Batches,            // Engine wake-ups with commands to run
+    MessagesSent,       // Per connection written to
+    BytesSent
+};
+constexpr size_t kCounters = 13;
+
+// Written by one thread (the engine), read at any time
+enum class Gauge : uint8_t {
+    RestingOrders,      // Stops included
+    BidLevels,
+    AskLevels
+};
+constexpr size_t kGauges = 3;
+
+// Process-wide allocator totals (glibc mallinfo2); all 0 if unavailable
+struct AllocatorStats {
+    bool available = false;
+    uint64_t arenaBytes = 0;    // From sbrk and arena mmaps
+    uint64_t inUseBytes = 0;
+    uint64_t freeBytes = 0;     // Held by malloc, not in use
+    uint64_t mmapBytes = 0;     // Large blocks mapped directly
+};
+AllocatorStats allocatorStats();
+
+// Operational counters kept per thread (see PerThread) and summed only when
+// read, so threads never write to a shared cache line. The counters are
+// monotonic; rates are left to the scraper.
+class Metrics {
+public:
+    void add(Counter counter, uint64_t n = 1) {
+        auto& slot = shards.local().counters[static_cast<size_t>(counter)];
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    // Commands taken from the queue in one go
+    void recordBatch(uint64_t commands) { shards.local().batchSizes.record(commands); }
+    void set(Gauge gauge, uint64_t value) {
+        gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t get(Counter counter) const;
+    uint64_t get(Gauge gauge) const { return gauges[static_cast<size_t>(gauge)].load(std::memory_order_relaxed); }
+    // All threads' batch sizes merged into `into`
+    void batchSizes(LatencyHistogram& into) const;
+
+private:
+    struct Shard {
+        std::array<std::atomic<uint64_t>, kCounters> counters{};
+        LatencyHistogram batchSizes;    // Log-linear, so it serves for sizes too
+    };
+
+    PerThread<Shard> shards;
+    std::array<std::atomic<uint64_t>, kGauges> gauges{};
+};
+
+} // namespace ome
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ome {
+
+// Instance ids for PerThread; never reused, unlike addresses
+inline std::atomic<uint64_t> nextPerThreadId{1};
+
+// One T per thread that touches the instance, for single-writer statistics
+// read by other threads. local() finds the calling thread's T through a
+// thread_local cache, so only a thread's first call (or its first after using
+// another instance) takes the lock. Each T lives as long as the instance,
+// keeping what threads that have exited recorded.
+template <typename T>
+class PerThread {
+public:
+    PerThread() : id(nextPerThreadId.fetch_add(1, std::memory_order_relaxed)) {}
+    PerThread(const PerThread&) = delete;
+    PerThread& operator=(const PerThread&) = delete;
+
+    T& local() {
+        thread_local uint64_t cachedOwner = 0;
+        thread_local T* cached = nullptr;
+        if (cachedOwner == id) return *cached;
+        cached = &attach();
+        cachedOwner = id;
+        return *cached;
+    }
+
+    // Visits every thread's T; they may be recording meanwhile
+    template <typename F>
+    void forEach(F&& f) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : values) f(*entry.second);
+    }
+
+private:
+    T& attach() {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto self = std::this_thread::get_id();
+        for (auto& [thread, value] : values) {
+            if (thread == self) return *value;
+        }
+        values.emplace_back(self, std::make_unique<T>());
+        return *values.back().second;
+    }
+
+    const uint64_t id;
+    mutable std::mutex mutex;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<T>>> values;
+};
+
+} // namespace ome
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
+#include <optional>
 #include <string>
 #include <chrono>
 
@@ -10,6 +12,13 @@ namespace ome {
 using Price = uint64_t;
 using Quantity = uint64_t;
 using OrderId = uint64_t;
+using AccountId = uint64_t;
+using SessionId = uint64_t;
+
+// Account 0 means "no account"; such orders are never self-trade checked
+constexpr AccountId kNoAccount = 0;
+// Session 0: the order has no connection to report back to
+constexpr SessionId kNoSession = 0;
 
 enum class Side {
     Buy,
@@ -18,22 +27,73 @@ enum class Side {
 
 enum class OrderType {
     Limit,
-    Market
+    Market,
+    Stop,       // Becomes Market when triggered
+    StopLimit   // Becomes Limit when triggered
+};
+
+enum class TimeInForce {
+    GTC,    // Good till cancel
+    Day,    // Expires at the engine's session close
+    GTT     // Good till time/date: expires at Order::expireAt
+};
+
+// Self-trade prevention, applied by the aggressor when it meets a resting
+// order of the same account
+enum class StpMode {
+    CancelNewest,   // Cancel the rest of the aggressor
+    CancelOldest,   // Cancel the resting order and keep matching
+    CancelBoth,
+    Decrement       // Reduce both by the overlap without printing a trade
 };
 
 struct Order {
     OrderId id;
     Side side;
     Price price;
+    OrderType type = OrderType::Limit;
+    Price stopPrice = 0;                    // Trigger price for Stop/StopLimit
+    AccountId account = kNoAccount;
+    SessionId session = kNoSession;         // Where execution reports go
+    StpMode stpMode = StpMode::CancelNewest;
+    TimeInForce timeInForce = TimeInForce::GTC;
+    std::chrono::system_clock::time_point expireAt{}; // GTT deadline
+
+    // Per-account intrusive list, maintained by OrderBook while the order
+    // is in the book (resting or pending stop)
+    Order* accountPrev = nullptr;
+    Order* accountNext = nullptr;
     Quantity initialQuantity;
-    Quantity remainingQuantity;
+    Quantity remainingQuantity;             // Displayed (visible) open quantity once resting
+    Quantity displayQuantity = 0;           // Iceberg slice size, 0 = fully displayed
+    Quantity hiddenQuantity = 0;            // Iceberg reserve not shown in the book
     std::chrono::system_clock::time_point timestamp;
 
+    // timestamp is stamped by the engine from its clock when the order is
+    // processed, and again whenever it joins the back of a queue (size
+    // increase, price change, iceberg refresh, stop trigger)
     Order(OrderId id, Side side, Price price, Quantity qty)
         : id(id), side(side), price(price), initialQuantity(qty), remainingQuantity(qty),
-          timestamp(std::chrono::system_clock::now()) {}
+          timestamp() {}
     
     bool isFilled() const { return remainingQuantity == 0; }
+    Quantity openQuantity() const { return remainingQuantity + hiddenQuantity; }
+
+    // Moves everything above the display size into the hidden reserve
+    void hideReserve() {
+        if (displayQuantity > 0 && remainingQuantity > displayQuantity) {
+            hiddenQuantity += remainingQuantity - displayQuantity;
+            remainingQuantity = displayQuantity;
+        }
+    }
+
+    // Refills the displayed slice from the reserve; false if nothing is left
+    bool replenish() {
+        if (hiddenQuantity == 0) return false;
+        remainingQuantity = std::min(displayQuantity, hiddenQuantity);
+        hiddenQuantity -= remainingQuantity;
+        return true;
+    }
 };
 
 struct Trade {
@@ -44,10 +104,60 @@ struct Trade {
     std::chrono::system_clock::time_point timestamp;
 };
 
+enum class ExecType {
+    New,            // Accepted by the book
+    PartialFill,
+    Fill,
+    Canceled,       // By request, STP, mass cancel, or unfilled market remainder
+    Replaced,       // Modified; price/leaves show the new terms
+    Rejected,       // Duplicate id, or cancel/modify of an unknown order
+    Expired         // Day/GTT deadline
+};
+
+// Private per-order event for the owning session. cumQuantity + leavesQuantity
+// is the order's current total; leaves is 0 once the order is done.
+struct ExecutionReport {
+    ExecType type;
+    OrderId orderId;
+    SessionId session;
+    Side side;
+    Price price;
+    Price lastPrice;            // Fills only
+    Quantity lastQuantity;      // Fills only
+    Quantity leavesQuantity;
+    Quantity cumQuantity;
+    std::chrono::system_clock::time_point timestamp;
+};
+
+// Public trade print: one per aggressor per price level, aggregating the
+// per-maker Trades behind it
+struct TradePrint {
+    Price price;
+    Quantity quantity;
+    uint32_t makerCount;
+    OrderId takerOrderId;
+    std::chrono::system_clock::time_point timestamp;
+};
+
 // Level info for GUI
 struct LevelInfo {
     Price price;
     Quantity quantity;
 };
 
+// Mass-cancel selection: all orders of one account, optionally limited to a
+// side and an inclusive price band (stop price for pending stops)
+struct MassCancelRequest {
+    AccountId account = kNoAccount;
+    std::optional<Side> side;
+    Price minPrice = 0;
+    Price maxPrice = std::numeric_limits<Price>::max();
+};
+
+// Indicative uncross during a call auction
+struct AuctionInfo {
+    Price price;
+    Quantity volume;
+};
+
 } // namespace ome
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "common/types.hpp"
+#include "common/Latency.hpp"
+#include <optional>
+#include <vector>
+
+namespace ome {
+
+// One inbound request to the engine thread. Everything but Stop is sequenced
+// and journaled in this form.
+struct Command {
+    enum Type { Add, Cancel, BulkCancel, Modify, MassCancel, StartAuction, Uncross, Expire, Stop };
+    Type type;
+    std::optional<Order> order;
+    std::optional<OrderId> orderId;
+    Price price = 0;       // Modify: new price
+    Quantity quantity = 0; // Modify: new open quantity
+    MassCancelRequest massCancel{};
+    std::vector<OrderId> orderIds{}; // BulkCancel, Expire (one timer sweep)
+    SessionId session = kNoSession;  // Cancel/Modify: who to tell if the order is unknown
+    LatencyStamps stamps{};          // Not journaled
+};
+
+} // namespace ome
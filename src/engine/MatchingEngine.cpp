@@ -1,12 +1,20 @@
 #include "MatchingEngine.hpp"
+#include "persistence/Journal.hpp"
+#include "persistence/Snapshot.hpp"
+#include "replication/Replication.hpp"
 #include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace ome {
 
-MatchingEngine::MatchingEngine() : running(false) {}
+MatchingEngine::MatchingEngine(std::shared_ptr<EngineClock> clock)
+    : clock(std::move(clock)), timers(this->clock->now()), running(false) {}
 
 MatchingEngine::~MatchingEngine() {
     stop();
+    // Its last group may still release held reports into this engine
+    if (journal) journal->stop();
 }
 
 void MatchingEngine::start() {
@@ -16,79 +24,415 @@ void MatchingEngine::start() {
 
 void MatchingEngine::stop() {
     if (running) {
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            commandQueue.push({Command::Stop, std::nullopt, std::nullopt});
-        }
-        queueCv.notify_one();
+        enqueue({Command::Stop, std::nullopt, std::nullopt});
         if (engineThread.joinable()) {
             engineThread.join();
         }
         running = false;
     }
+    reapSnapshot(true);
 }
 
-void MatchingEngine::addOrder(Order order) {
+void MatchingEngine::enqueue(Command cmd) {
+    if (latency) {
+        cmd.stamps.enqueue = latencyTicks();
+        if (const LatencyStamps* frame = LatencyScope::current()) {
+            cmd.stamps.ingress = frame->ingress;
+            latency->record(LatencyStage::Parse, cmd.stamps.ingress, cmd.stamps.enqueue);
+        }
+    }
     {
         std::lock_guard<std::mutex> lock(queueMutex);
-        commandQueue.push({Command::Add, order, std::nullopt});
+        commandQueue.push(std::move(cmd));
     }
     queueCv.notify_one();
 }
 
-void MatchingEngine::cancelOrder(OrderId orderId) {
-    {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        commandQueue.push({Command::Cancel, std::nullopt, orderId});
-    }
-    queueCv.notify_one();
+size_t MatchingEngine::queueDepth() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return commandQueue.size();
+}
+
+void MatchingEngine::addOrder(Order order) {
+    enqueue({Command::Add, order, std::nullopt});
+}
+
+void MatchingEngine::cancelOrder(OrderId orderId, SessionId session) {
+    Command cmd{Command::Cancel, std::nullopt, orderId};
+    cmd.session = session;
+    enqueue(std::move(cmd));
+}
+
+void MatchingEngine::cancelOrders(std::vector<OrderId> orderIds) {
+    Command cmd{Command::BulkCancel, std::nullopt, std::nullopt};
+    cmd.orderIds = std::move(orderIds);
+    enqueue(std::move(cmd));
+}
+
+void MatchingEngine::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity, SessionId session) {
+    Command cmd{Command::Modify, std::nullopt, orderId, newPrice, newQuantity};
+    cmd.session = session;
+    enqueue(std::move(cmd));
+}
+
+void MatchingEngine::massCancel(const MassCancelRequest& request) {
+    Command cmd{Command::MassCancel, std::nullopt, std::nullopt};
+    cmd.massCancel = request;
+    enqueue(std::move(cmd));
+}
+
+void MatchingEngine::startAuction() {
+    enqueue({Command::StartAuction, std::nullopt, std::nullopt});
+}
+
+void MatchingEngine::uncross() {
+    enqueue({Command::Uncross, std::nullopt, std::nullopt});
+}
+
+void MatchingEngine::setSessionClose(Timestamp close) {
+    sessionClose = close;
 }
 
 void MatchingEngine::setTradeCallback(TradeCallback cb) {
     onTrade = cb;
 }
 
+void MatchingEngine::setTradePrintCallback(TradePrintCallback cb) {
+    onTradePrint = cb;
+}
+
 void MatchingEngine::setBookUpdateCallback(BookUpdateCallback cb) {
     onBookUpdate = cb;
 }
 
+void MatchingEngine::setOrderClosedCallback(OrderClosedCallback cb) {
+    orderBook.setOrderClosedCallback(std::move(cb));
+}
+
+void MatchingEngine::setExecutionReportCallback(ExecutionReportCallback cb) {
+    onExecutionReport = std::move(cb);
+    orderBook.setReportSink(onExecutionReport ? &reports : nullptr);
+}
+
+void MatchingEngine::setJournal(Journal* j) {
+    journal = j;
+    if (journal && journal->durability() == Durability::Sync) {
+        journal->setDurableCallback([this](uint64_t durableSequence) {
+            releaseReports(durableSequence);
+        });
+    }
+}
+
+void MatchingEngine::setReplication(ReplicationPublisher* publisher) {
+    replication = publisher;
+}
+
+void MatchingEngine::recover(const JournalRecord& record) {
+    Command cmd = record.command;
+    sequence = record.sequence;
+    apply(cmd, record.timestamp);
+}
+
 OrderBook& MatchingEngine::getOrderBook() {
     return orderBook;
 }
 
 void MatchingEngine::run() {
-    while (running) {
-        Command cmd;
+    std::queue<Command> batch;
+    bool stopping = false;
+
+    while (!stopping) {
         {
+            // Sleep until work arrives or the next timer may be due, then take
+            // everything queued in one go
             std::unique_lock<std::mutex> lock(queueMutex);
-            queueCv.wait(lock, [this] { return !commandQueue.empty(); });
-            cmd = commandQueue.front();
-            commandQueue.pop();
+            auto ready = [this] { return !commandQueue.empty(); };
+            if (auto wakeup = timers.nextWakeup()) {
+                // Relative to the engine clock, which need not be wall time
+                queueCv.wait_for(lock, *wakeup - clock->now(), ready);
+            } else {
+                queueCv.wait(lock, ready);
+            }
+            std::swap(batch, commandQueue);
+        }
+        if (metrics && !batch.empty()) {
+            metrics->add(Counter::Batches);
+            metrics->recordBatch(batch.size());
         }
 
-        if (cmd.type == Command::Stop) break;
+        // Expiry runs between command batches as one sweep, before the new
+        // batch so nothing trades against an order past its deadline
+        bool bookChanged = expireOrders();
 
-        bool bookChanged = false;
-        if (cmd.type == Command::Add && cmd.order) {
-            auto trades = orderBook.addOrder(*cmd.order);
-            if (!trades.empty()) {
-                if (onTrade) onTrade(trades);
-                bookChanged = true;
+        while (!batch.empty()) {
+            if (batch.front().type == Command::Stop) {
+                stopping = true;
+                break;
             }
-            // If order was added to book (not fully filled), book changed
-            if (!cmd.order->isFilled()) {
+            bookChanged |= process(batch.front());
+            batch.pop();
+        }
+
+        // One book update per batch rather than per command
+        if (bookChanged && onBookUpdate) {
+            onBookUpdate();
+        }
+        if (bookChanged && metrics) {
+            metrics->set(Gauge::RestingOrders, orderBook.orderCount());
+            metrics->set(Gauge::BidLevels, orderBook.levelCount(Side::Buy));
+            metrics->set(Gauge::AskLevels, orderBook.levelCount(Side::Sell));
+        }
+
+        maybeSnapshot();
+    }
+}
+
+void MatchingEngine::setSnapshotPolicy(std::string path, uint64_t everyCommands) {
+    snapshotPath = std::move(path);
+    snapshotTmpPath = Snapshot::tmpPath(snapshotPath);
+    snapshotInterval = everyCommands;
+}
+
+std::optional<uint64_t> MatchingEngine::restoreSnapshot(const std::string& path) {
+    auto restored = Snapshot::load(path, orderBook);
+    if (!restored) return std::nullopt;
+
+    sequence = snapshotSequence = *restored;
+    orderBook.visitOrders([this](const Order& order) {
+        if (order.timeInForce != TimeInForce::GTC && order.expireAt.time_since_epoch().count() > 0) {
+            timers.schedule(order.id, order.expireAt);
+        }
+    });
+    return restored;
+}
+
+void MatchingEngine::maybeSnapshot() {
+    if (snapshotPath.empty() || snapshotInterval == 0) return;
+    reapSnapshot(false);
+    if (snapshotChild > 0 || sequence - snapshotSequence < snapshotInterval) return;
+
+    // The child sees the book exactly as of `sequence` and writes it out
+    // while this thread carries on; pages are only copied as they change.
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        _exit(Snapshot::write(snapshotPath, snapshotTmpPath, orderBook, sequence) ? 0 : 1);
+    }
+    if (pid < 0) {
+        std::cerr << "Snapshot fork failed" << std::endl;
+        return;
+    }
+    snapshotChild = pid;
+    snapshotSequence = sequence;
+}
+
+void MatchingEngine::reapSnapshot(bool wait) {
+    if (snapshotChild <= 0) return;
+
+    int status = 0;
+    pid_t done = ::waitpid(snapshotChild, &status, wait ? 0 : WNOHANG);
+    if (done == 0) return; // Still writing
+    if (done == snapshotChild && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+        std::cerr << "Snapshot at sequence " << snapshotSequence << " failed" << std::endl;
+    }
+    snapshotChild = -1;
+}
+
+bool MatchingEngine::process(Command& cmd) {
+    if (latency) {
+        cmd.stamps.dequeue = latencyTicks();
+        latency->record(LatencyStage::Queue, cmd.stamps.enqueue, cmd.stamps.dequeue);
+    }
+
+    // One clock sample per command; every event it produces shares it
+    const Timestamp now = clock->now();
+
+    // Resolve the session close first so the journal holds the deadline the
+    // order actually got. Once a close has passed the next day's applies.
+    if (cmd.type == Command::Add && cmd.order &&
+        cmd.order->timeInForce == TimeInForce::Day && sessionClose) {
+        if (*sessionClose <= now) {
+            *sessionClose += std::chrono::floor<std::chrono::days>(now - *sessionClose) + std::chrono::days(1);
+        }
+        cmd.order->expireAt = *sessionClose;
+    }
+
+    ++sequence;
+    if (metrics) countCommand(cmd);
+    if (journal) {
+        journal->append(sequence, now, cmd);
+    }
+    if (!replication) {
+        return apply(cmd, now);
+    }
+
+    replication->publish(sequence, now, cmd);
+    bool bookChanged = apply(cmd, now);
+    if (replication->checkpointDue(sequence)) {
+        replication->checkpoint(sequence, orderBook.stateHash());
+    }
+    return bookChanged;
+}
+
+bool MatchingEngine::apply(Command& cmd, Timestamp now) {
+    orderBook.setTime(now);
+
+    bool bookChanged = false;
+    std::vector<Trade> trades;
+    if (cmd.type == Command::Add && cmd.order) {
+        Order& order = *cmd.order;
+        // A duplicate id is rejected; its expiry must not touch the live order's
+        const bool accepted = !orderBook.hasOrder(order.id);
+        // Rejects, market remainders and pending stops leave the depth alone
+        const uint64_t depthBefore = orderBook.depthVersion();
+        trades = orderBook.addOrder(order);
+        bookChanged = orderBook.depthVersion() != depthBefore;
+
+        if (accepted && order.timeInForce != TimeInForce::GTC &&
+            order.expireAt.time_since_epoch().count() > 0 &&
+            orderBook.hasOrder(order.id)) {
+            timers.schedule(order.id, order.expireAt);
+        }
+    } else if (cmd.type == Command::Cancel && cmd.orderId) {
+        timers.cancel(*cmd.orderId);
+        if (orderBook.cancelOrder(*cmd.orderId)) {
+            bookChanged = true;
+        } else {
+            rejectRequest(*cmd.orderId, cmd.session, now);
+        }
+    } else if (cmd.type == Command::BulkCancel) {
+        for (OrderId id : cmd.orderIds) {
+            timers.cancel(id);
+            if (orderBook.cancelOrder(id)) {
                 bookChanged = true;
             }
-        } else if (cmd.type == Command::Cancel && cmd.orderId) {
-            if (orderBook.cancelOrder(*cmd.orderId)) {
+        }
+    } else if (cmd.type == Command::Modify && cmd.orderId) {
+        if (orderBook.modifyOrder(*cmd.orderId, cmd.price, cmd.quantity, trades)) {
+            bookChanged = true;
+        } else {
+            rejectRequest(*cmd.orderId, cmd.session, now);
+        }
+    } else if (cmd.type == Command::MassCancel) {
+        if (orderBook.massCancel(cmd.massCancel) > 0) {
+            bookChanged = true;
+        }
+    } else if (cmd.type == Command::Expire) {
+        for (OrderId id : cmd.orderIds) {
+            timers.cancel(id); // Already gone unless replaying
+            if (orderBook.expireOrder(id)) {
                 bookChanged = true;
             }
         }
+    } else if (cmd.type == Command::StartAuction) {
+        orderBook.startAuction();
+        bookChanged = true;
+    } else if (cmd.type == Command::Uncross) {
+        trades = orderBook.uncross();
+        bookChanged = true;
+    }
 
-        if (bookChanged && onBookUpdate) {
-            onBookUpdate();
+    // Recovery carries no stamps
+    if (latency && cmd.stamps.dequeue) {
+        cmd.stamps.matched = latencyTicks();
+        latency->record(LatencyStage::Match, cmd.stamps.dequeue, cmd.stamps.matched);
+    }
+    if (!trades.empty()) publishTrades(trades, cmd.stamps);
+    publishReports(cmd.stamps);
+    return bookChanged;
+}
+
+const LatencyStamps* MatchingEngine::stampPublish(LatencyStamps& stamps) {
+    if (!latency || !stamps.matched) return nullptr;
+    stamps.published = latencyTicks();
+    latency->record(LatencyStage::Publish, stamps.matched, stamps.published);
+    return &stamps;
+}
+
+void MatchingEngine::publishReports(LatencyStamps& stamps) {
+    if (reports.empty()) return;
+
+    if (journal && journal->durability() == Durability::Sync) {
+        {
+            std::lock_guard<std::mutex> lock(heldMutex);
+            heldReports.push_back({sequence, std::move(reports), stamps});
+        }
+        reports.clear();
+        // The journaler may already have synced this sequence, in which case
+        // no later callback would come for it
+        releaseReports(journal->durableSequence());
+        return;
+    }
+
+    LatencyScope scope(stampPublish(stamps));
+    onExecutionReport(reports);
+    reports.clear();
+}
+
+void MatchingEngine::releaseReports(uint64_t durableSequence) {
+    // Under the lock so releases from either thread stay in sequence order
+    std::lock_guard<std::mutex> lock(heldMutex);
+    while (!heldReports.empty() && heldReports.front().sequence <= durableSequence) {
+        HeldReports& held = heldReports.front();
+        LatencyScope scope(stampPublish(held.stamps));
+        onExecutionReport(held.reports);
+        heldReports.pop_front();
+    }
+}
+
+void MatchingEngine::rejectRequest(OrderId orderId, SessionId session, Timestamp now) {
+    if (!onExecutionReport || session == kNoSession) return;
+    reports.push_back({ExecType::Rejected, orderId, session, Side::Buy, 0, 0, 0, 0, 0, now});
+}
+
+void MatchingEngine::countCommand(const Command& cmd) {
+    metrics->add(Counter::Commands);
+    switch (cmd.type) {
+    case Command::Add:        metrics->add(Counter::Orders); break;
+    case Command::Cancel:     metrics->add(Counter::Cancels); break;
+    case Command::BulkCancel: metrics->add(Counter::Cancels, cmd.orderIds.size()); break;
+    case Command::Modify:     metrics->add(Counter::Modifies); break;
+    case Command::MassCancel: metrics->add(Counter::MassCancels); break;
+    default: break;
+    }
+}
+
+void MatchingEngine::publishTrades(const std::vector<Trade>& trades, LatencyStamps& stamps) {
+    if (metrics) {
+        Quantity traded = 0;
+        for (const auto& t : trades) traded += t.quantity;
+        metrics->add(Counter::Trades, trades.size());
+        metrics->add(Counter::TradedQuantity, traded);
+    }
+    if (onTrade) onTrade(trades);
+    if (!onTradePrint) return;
+
+    // Fills arrive grouped by aggressor and level, so one pass merges each run
+    // of the same taker at the same price into a single print
+    prints.clear();
+    for (const auto& t : trades) {
+        if (!prints.empty() && prints.back().takerOrderId == t.takerOrderId &&
+            prints.back().price == t.price) {
+            prints.back().quantity += t.quantity;
+            ++prints.back().makerCount;
+        } else {
+            prints.push_back({t.price, t.quantity, 1, t.takerOrderId, t.timestamp});
         }
     }
+    LatencyScope scope(stampPublish(stamps));
+    onTradePrint(prints);
+}
+
+bool MatchingEngine::expireOrders() {
+    expired.clear();
+    timers.advance(clock->now(), expired);
+    if (expired.empty()) return false;
+
+    // The sweep is sequenced and journaled like any other command, so replay
+    // expires the same orders at the same point. Timers of orders that
+    // already filled simply miss.
+    Command cmd{Command::Expire, std::nullopt, std::nullopt};
+    cmd.orderIds = expired;
+    return process(cmd);
 }
 
 } // namespace ome
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "OrderBook.hpp"
+#include "Command.hpp"
+#include "TimerWheel.hpp"
+#include "common/Metrics.hpp"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -8,32 +11,96 @@
 #include <variant>
 #include <functional>
 #include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <sys/types.h>
 
 namespace ome {
 
-struct Command {
-    enum Type { Add, Cancel, Stop };
-    Type type;
-    std::optional<Order> order;
-    std::optional<OrderId> orderId;
-};
+class Journal;
+struct JournalRecord;
+class ReplicationPublisher;
 
 class MatchingEngine {
 public:
     using TradeCallback = std::function<void(const std::vector<Trade>&)>;
+    using TradePrintCallback = std::function<void(const std::vector<TradePrint>&)>;
     using BookUpdateCallback = std::function<void()>;
+    using OrderClosedCallback = OrderBook::OrderClosedCallback;
+    using ExecutionReportCallback = std::function<void(const std::vector<ExecutionReport>&)>;
 
-    MatchingEngine();
+    // The clock is sampled once per command (SimulatedClock for replay)
+    explicit MatchingEngine(std::shared_ptr<EngineClock> clock = std::make_shared<SystemClock>());
     ~MatchingEngine();
 
     void start();
     void stop();
 
     void addOrder(Order order);
-    void cancelOrder(OrderId orderId);
+    // session receives the Rejected report if the order is not found
+    void cancelOrder(OrderId orderId, SessionId session = kNoSession);
+    // Cancels a batch of orders as a single command (unknown ids are ignored)
+    void cancelOrders(std::vector<OrderId> orderIds);
+    void modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity, SessionId session = kNoSession);
+    // One command for all selected orders of an account; one book update
+    void massCancel(const MassCancelRequest& request);
+
+    // Call auction phase: orders accumulate unmatched until uncross()
+    void startAuction();
+    void uncross();
+
+    // Expiry time for TimeInForce::Day orders; set before start(). It rolls
+    // forward a day at a time once it has passed.
+    void setSessionClose(Timestamp close);
+    // Without a session close Day orders could never expire, so the server
+    // refuses them
+    bool hasSessionClose() const { return sessionClose.has_value(); }
 
+    // Per-maker fills (private execution stream)
     void setTradeCallback(TradeCallback cb);
+    // Optional public feed: fills aggregated per aggressor per price level
+    void setTradePrintCallback(TradePrintCallback cb);
     void setBookUpdateCallback(BookUpdateCallback cb);
+    // Engine thread, once per order as it leaves the book (see OrderBook)
+    void setOrderClosedCallback(OrderClosedCallback cb);
+    // Private per-order events, delivered after each command; set before start()
+    void setExecutionReportCallback(ExecutionReportCallback cb);
+
+    // Write-ahead journal for every sequenced command; set before start().
+    // With Durability::Sync, execution reports are held until their command
+    // is durable and delivered from the journaler thread. The journal must
+    // outlive the engine, which stops it on destruction.
+    void setJournal(Journal* journal);
+    // Re-applies a journaled command on the caller's thread, at its recorded
+    // time and sequence number. Only before start().
+    void recover(const JournalRecord& record);
+    uint64_t lastSequence() const { return sequence; }
+
+    // Hot-standby stream: every sequenced command is published after it is
+    // journaled, plus a book state hash at the publisher's checkpoints. The
+    // publisher must outlive the engine; set before start().
+    void setReplication(ReplicationPublisher* publisher);
+
+    // Per-stage latency of each command, from the ingress stamp in the
+    // caller's LatencyScope (if any) to the callbacks, which run inside a
+    // scope holding the command's stamps. The recorder must outlive the
+    // engine; set before start().
+    void setLatencyRecorder(LatencyRecorder* recorder) { latency = recorder; }
+    // Command, trade and batch counters and book depth gauges, for live
+    // commands only: set after recovery, before start(). Must outlive the
+    // engine.
+    void setMetrics(Metrics* sink) { metrics = sink; }
+    // Commands waiting for the engine thread (takes the queue lock)
+    size_t queueDepth();
+
+    // Writes a snapshot to `path` every `everyCommands` sequenced commands,
+    // from a forked copy-on-write image of the process so matching only
+    // pauses for the fork itself. Set before start().
+    void setSnapshotPolicy(std::string path, uint64_t everyCommands);
+    // Bulk-loads a snapshot into the (empty) book before start() and re-arms
+    // expiry timers. Returns its sequence number; replay the journal after it.
+    std::optional<uint64_t> restoreSnapshot(const std::string& path);
 
     // Direct access for snapshot (thread-unsafe if engine running, use with care or add lock)
     // For this simple implementation, we'll assume single consumer of this data or add a lock.
@@ -41,8 +108,26 @@ public:
 
 private:
     void run();
+    void enqueue(Command cmd);
+    // Sequences, journals and applies one command; returns true if the book changed
+    bool process(Command& cmd);
+    bool apply(Command& cmd, Timestamp now);
+    bool expireOrders();
+    void countCommand(const Command& cmd);
+    void maybeSnapshot();
+    void reapSnapshot(bool wait);
+    void publishTrades(const std::vector<Trade>& trades, LatencyStamps& stamps);
+    void publishReports(LatencyStamps& stamps);
+    // Stamps the hand-off to a callback; the scope to run it under
+    const LatencyStamps* stampPublish(LatencyStamps& stamps);
+    void releaseReports(uint64_t durableSequence);
+    void rejectRequest(OrderId orderId, SessionId session, Timestamp now);
 
+    std::shared_ptr<EngineClock> clock;
     OrderBook orderBook;
+    TimerWheel timers;                  // Engine thread only
+    std::vector<OrderId> expired;
+    std::optional<Timestamp> sessionClose;
     std::queue<Command> commandQueue;
     std::mutex queueMutex;
     std::condition_variable queueCv;
@@ -50,7 +135,31 @@ private:
     std::thread engineThread;
 
     TradeCallback onTrade;
+    TradePrintCallback onTradePrint;
+    std::vector<TradePrint> prints;
     BookUpdateCallback onBookUpdate;
+    ExecutionReportCallback onExecutionReport;
+    std::vector<ExecutionReport> reports; // Filled by the book, drained per command
+
+    uint64_t sequence = 0;               // Last command sequenced (engine thread)
+    Journal* journal = nullptr;
+    ReplicationPublisher* replication = nullptr;
+    LatencyRecorder* latency = nullptr;
+    Metrics* metrics = nullptr;
+    // Durability::Sync: reports waiting for their command's sequence to be durable
+    struct HeldReports {
+        uint64_t sequence;
+        std::vector<ExecutionReport> reports;
+        LatencyStamps stamps;
+    };
+    std::deque<HeldReports> heldReports;
+    std::mutex heldMutex;
+
+    std::string snapshotPath;
+    std::string snapshotTmpPath;         // Built here: the forked writer must not allocate
+    uint64_t snapshotInterval = 0;
+    uint64_t snapshotSequence = 0;       // Sequence of the last snapshot started
+    pid_t snapshotChild = -1;
 };
 
 } // namespace ome
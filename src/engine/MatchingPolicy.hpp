@@ -0,0 +1,80 @@
+#pragma once
+
+#include "common/types.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+namespace ome {
+
+// Allocation policies for BasicOrderBook, selected at compile time.
+//
+// matchLevel(level, remaining, fill) distributes the aggressor over the orders
+// of one price level. `remaining` aliases the aggressor's open quantity.
+// fill(orderIt, qty) books one trade, reduces `remaining` and returns the
+// iterator to continue from; removal of filled makers and iceberg refresh
+// are handled by the book.
+
+// Price-time priority: oldest order first
+struct FifoPolicy {
+    template<typename LevelT, typename Fill>
+    static void matchLevel(LevelT& level, const Quantity& remaining, Fill&& fill) {
+        auto it = level.orders.begin();
+        while (it != level.orders.end() && remaining > 0) {
+            it = fill(it, std::min(remaining, it->remainingQuantity));
+        }
+    }
+};
+
+// Pro-rata by displayed size. Each share is taken from cumulative rounding,
+//   share_i = floor(cum_i * Q / V) - floor(cum_(i-1) * Q / V)
+// which sums to exactly Q in one pass over the level: no leftover round and
+// no per-order state. Rounding remainders fall to the later orders.
+struct ProRataPolicy {
+    template<typename LevelT, typename Fill>
+    static void matchLevel(LevelT& level, const Quantity& remaining, Fill&& fill) {
+        const Quantity volume = level.totalVolume;
+        if (volume == 0) return;
+        const Quantity target = std::min(remaining, volume);
+
+        // 128-bit product: cum * target can exceed 64 bits
+        unsigned __int128 cumulative = 0;
+        Quantity allocated = 0;
+
+        // Bounded by the original count so refreshed icebergs moved to the
+        // back are not allocated twice in the same pass
+        size_t count = level.orders.size();
+        auto it = level.orders.begin();
+        for (size_t i = 0; i < count && it != level.orders.end() && remaining > 0; ++i) {
+            cumulative += it->remainingQuantity;
+            auto upTo = static_cast<Quantity>(cumulative * target / volume);
+            Quantity share = upTo - allocated;
+            allocated = upTo;
+            it = (share > 0) ? fill(it, share) : std::next(it);
+        }
+    }
+};
+
+// Top-order / LMM carve-out: the order at the head of the queue first receives
+// up to CarveOutPercent of the aggressor, the remainder is allocated pro-rata
+// across the whole level (including what the head order still shows).
+template<unsigned CarveOutPercent = 100>
+struct TopOrderProRataPolicy {
+    static_assert(CarveOutPercent <= 100, "carve-out is a percentage");
+
+    template<typename LevelT, typename Fill>
+    static void matchLevel(LevelT& level, const Quantity& remaining, Fill&& fill) {
+        auto top = level.orders.begin();
+        auto carveOut = static_cast<Quantity>(
+            static_cast<unsigned __int128>(remaining) * CarveOutPercent / 100);
+        carveOut = std::min(carveOut, top->remainingQuantity);
+        if (carveOut > 0) {
+            fill(top, carveOut);
+        }
+        if (remaining > 0 && !level.orders.empty()) {
+            ProRataPolicy::matchLevel(level, remaining, fill);
+        }
+    }
+};
+
+} // namespace ome
@@ -1,63 +1,401 @@
 #include "OrderBook.hpp"
+#include <algorithm>
+#include <cassert>
 #include <iostream>
+#include <iterator>
 
 namespace ome {
 
-OrderBook::OrderBook() {}
+namespace {
 
-std::vector<Trade> OrderBook::addOrder(Order order) {
+template<typename BookSide>
+Quantity openVolumeAt(const BookSide& book, Price price) {
+    auto it = book.find(price);
+    return (it != book.end()) ? it->second.openVolume : 0;
+}
+
+} // namespace
+
+template<typename MatchPolicy>
+BasicOrderBook<MatchPolicy>::BasicOrderBook() {}
+
+template<typename MatchPolicy>
+std::vector<Trade> BasicOrderBook<MatchPolicy>::addOrder(Order order) {
     std::vector<Trade> trades;
+    order.timestamp = currentTime;
 
-    if (orderLookup.find(order.id) != orderLookup.end()) {
+    if (orderLookup.find(order.id) != orderLookup.end() ||
+        stopLookup.find(order.id) != stopLookup.end()) {
         // Duplicate order ID, reject or ignore
+        orderClosed(order, ExecType::Rejected);
+        return trades;
+    }
+    report(order, ExecType::New);
+
+    if (auctionActive) {
+        // Orders only accumulate during the call; market orders have no
+        // price to rest at
+        if (order.type == OrderType::Limit) {
+            execute(order, trades);
+            updateIndicative();
+        } else if (order.type != OrderType::Market) {
+            addStop(order);
+        } else {
+            orderClosed(order);
+        }
         return trades;
     }
 
-    match(order, trades);
+    if (order.type == OrderType::Stop || order.type == OrderType::StopLimit) {
+        if (!isTriggered(order)) {
+            addStop(order);
+            return trades;
+        }
+        order.type = (order.type == OrderType::Stop) ? OrderType::Market : OrderType::Limit;
+    }
+
+    execute(order, trades);
+    processTriggers(trades);
 
-    if (!order.isFilled()) {
+    return trades;
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::execute(Order& order, std::vector<Trade>& trades) {
+    if (!auctionActive) {
+        match(order, trades);
+    }
+
+    // Market orders never rest; any unfilled remainder is dropped
+    if (!order.isFilled() && order.type != OrderType::Market) {
         if (order.side == Side::Buy) {
             addToBook(order, bids);
         } else {
             addToBook(order, asks);
         }
+    } else {
+        orderClosed(order);
     }
+}
 
-    return trades;
+template<typename MatchPolicy>
+bool BasicOrderBook<MatchPolicy>::isTriggered(const Order& stop) const {
+    if (!lastTradePrice) return false;
+    return (stop.side == Side::Buy) ? (*lastTradePrice >= stop.stopPrice)
+                                    : (*lastTradePrice <= stop.stopPrice);
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::addStop(Order& order) {
+    std::list<Order>* queue;
+    if (order.side == Side::Buy) {
+        queue = &buyStops[order.stopPrice];
+    } else {
+        queue = &sellStops[order.stopPrice];
+    }
+    queue->push_back(order);
+    linkAccount(queue->back());
+    ordersDigest += orderDigest(queue->back());
+    stopLookup.insert({order.id, {order.side, order.stopPrice, std::prev(queue->end())}});
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::collectTriggered(std::vector<Order>& triggered) {
+    auto drain = [&](auto& stops) {
+        while (!stops.empty() && isTriggered(stops.begin()->second.front())) {
+            for (Order& stop : stops.begin()->second) {
+                ordersDigest -= orderDigest(stop);
+                unlinkAccount(stop);
+                stopLookup.erase(stop.id);
+                stop.type = (stop.type == OrderType::Stop) ? OrderType::Market : OrderType::Limit;
+                stop.timestamp = currentTime;
+                triggered.push_back(stop);
+            }
+            stops.erase(stops.begin());
+        }
+    };
+    drain(buyStops);
+    drain(sellStops);
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::processTriggers(std::vector<Trade>& trades) {
+    // Triggered stops are run from a work list rather than recursively: each
+    // one may trade, move the last price and append further stops behind it.
+    std::vector<Order> triggered;
+    size_t next = 0;
+    size_t seenTrades = 0;
+
+    while (true) {
+        if (trades.size() > seenTrades) {
+            seenTrades = trades.size();
+            lastTradePrice = trades.back().price;
+            collectTriggered(triggered);
+        }
+        if (next == triggered.size()) break;
+
+        Order order = triggered[next++];
+        execute(order, trades);
+    }
 }
 
-bool OrderBook::cancelOrder(OrderId orderId) {
+template<typename MatchPolicy>
+bool BasicOrderBook<MatchPolicy>::removeOrder(OrderId orderId, ExecType reason) {
     auto it = orderLookup.find(orderId);
     if (it == orderLookup.end()) {
-        return false;
+        return cancelStop(orderId, reason);
     }
 
-    const auto& loc = it->second;
-    if (loc.side == Side::Buy) {
-        auto levelIt = bids.find(loc.price);
-        if (levelIt != bids.end()) {
-            levelIt->second.totalVolume -= loc.iterator->remainingQuantity;
-            levelIt->second.orders.erase(loc.iterator);
-            if (levelIt->second.orders.empty()) {
-                bids.erase(levelIt);
-            }
+    cancelResting(it, reason);
+    if (auctionActive) {
+        updateIndicative();
+    }
+    return true;
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::cancelResting(LookupIterator lookupIt, ExecType reason) {
+    const auto loc = lookupIt->second;
+    Level& level = *loc.level;
+    eraseResting(level, loc.iterator, reason);
+    if (level.orders.empty()) {
+        if (loc.side == Side::Buy) {
+            bids.erase(loc.price);
+        } else {
+            asks.erase(loc.price);
         }
+    }
+}
+
+template<typename MatchPolicy>
+std::list<Order>::iterator BasicOrderBook<MatchPolicy>::eraseResting(Level& level, std::list<Order>::iterator orderIt,
+                                                                     ExecType reason) {
+    level.totalVolume -= orderIt->remainingQuantity;
+    level.openVolume -= orderIt->openQuantity();
+    ++depthChanges;
+    trackAuctionVolume(orderIt->side, orderIt->price, 0, orderIt->openQuantity());
+    ordersDigest -= orderDigest(*orderIt);
+    unlinkAccount(*orderIt);
+    orderLookup.erase(orderIt->id);
+    orderClosed(*orderIt, reason);
+    return level.orders.erase(orderIt);
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::report(const Order& order, ExecType type, Price lastPrice, Quantity lastQuantity) {
+    if (!reportSink) return;
+
+    const Quantity open = order.openQuantity();
+    const bool done = (type == ExecType::Canceled || type == ExecType::Expired || type == ExecType::Rejected);
+    reportSink->push_back({
+        type,
+        order.id,
+        order.session,
+        order.side,
+        order.price,
+        lastPrice,
+        lastQuantity,
+        done ? 0 : open,
+        order.initialQuantity - open,
+        currentTime
+    });
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::linkAccount(Order& order) {
+    if (order.account == kNoAccount) return;
+
+    // New orders go in at the head; fills mostly remove old orders, so the
+    // head (and the map entry) rarely has to change on removal
+    Order*& head = accountOrders[order.account];
+    order.accountPrev = nullptr;
+    order.accountNext = head;
+    if (head) head->accountPrev = &order;
+    head = &order;
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::unlinkAccount(Order& order) {
+    if (order.account == kNoAccount) return;
+
+    if (order.accountNext) {
+        order.accountNext->accountPrev = order.accountPrev;
+    }
+    if (order.accountPrev) {
+        order.accountPrev->accountNext = order.accountNext;
+    } else if (order.accountNext) {
+        accountOrders[order.account] = order.accountNext;
     } else {
-        auto levelIt = asks.find(loc.price);
-        if (levelIt != asks.end()) {
-            levelIt->second.totalVolume -= loc.iterator->remainingQuantity;
-            levelIt->second.orders.erase(loc.iterator);
-            if (levelIt->second.orders.empty()) {
-                asks.erase(levelIt);
+        accountOrders.erase(order.account);
+    }
+    order.accountPrev = order.accountNext = nullptr;
+}
+
+template<typename MatchPolicy>
+size_t BasicOrderBook<MatchPolicy>::massCancel(const MassCancelRequest& request) {
+    auto chainIt = accountOrders.find(request.account);
+    if (chainIt == accountOrders.end()) {
+        return 0;
+    }
+
+    size_t cancelled = 0;
+    Order* order = chainIt->second;
+    while (order) {
+        Order* next = order->accountNext;
+        bool isStop = (order->type == OrderType::Stop || order->type == OrderType::StopLimit);
+        Price price = isStop ? order->stopPrice : order->price;
+
+        if ((!request.side || order->side == *request.side) &&
+            price >= request.minPrice && price <= request.maxPrice) {
+            if (isStop) {
+                cancelStop(order->id);
+            } else {
+                cancelResting(orderLookup.find(order->id));
             }
+            ++cancelled;
         }
+        order = next;
+    }
+
+    if (cancelled > 0 && auctionActive) {
+        updateIndicative();
+    }
+    return cancelled;
+}
+
+template<typename MatchPolicy>
+bool BasicOrderBook<MatchPolicy>::cancelStop(OrderId orderId, ExecType reason) {
+    auto it = stopLookup.find(orderId);
+    if (it == stopLookup.end()) {
+        return false;
+    }
+
+    const auto& loc = it->second;
+    ordersDigest -= orderDigest(*loc.iterator);
+    unlinkAccount(*loc.iterator);
+    orderClosed(*loc.iterator, reason);
+    auto eraseFrom = [&](auto& stops) {
+        auto queueIt = stops.find(loc.stopPrice);
+        queueIt->second.erase(loc.iterator);
+        if (queueIt->second.empty()) {
+            stops.erase(queueIt);
+        }
+    };
+    if (loc.side == Side::Buy) {
+        eraseFrom(buyStops);
+    } else {
+        eraseFrom(sellStops);
+    }
+
+    stopLookup.erase(it);
+    return true;
+}
+
+template<typename MatchPolicy>
+bool BasicOrderBook<MatchPolicy>::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity, std::vector<Trade>& trades) {
+    auto it = orderLookup.find(orderId);
+    if (it == orderLookup.end()) {
+        return false;
     }
 
-    orderLookup.erase(it);
+    if (it->second.side == Side::Buy) {
+        modifyInBook(it, newPrice, newQuantity, bids, asks, trades);
+    } else {
+        modifyInBook(it, newPrice, newQuantity, asks, bids, trades);
+    }
+    if (auctionActive) {
+        updateIndicative();
+    } else {
+        processTriggers(trades);
+    }
     return true;
 }
 
-void OrderBook::match(Order& incoming, std::vector<Trade>& trades) {
+template<typename MatchPolicy>
+template<typename BookSide, typename OppositeSide>
+void BasicOrderBook<MatchPolicy>::modifyInBook(LookupIterator lookupIt,
+                                               Price newPrice, Quantity newQuantity,
+                                               BookSide& book, OppositeSide& opposite, std::vector<Trade>& trades) {
+    auto& loc = lookupIt->second;
+    Level& level = *loc.level;
+    Order& order = *loc.iterator;
+
+    if (newQuantity == 0) {
+        cancelResting(lookupIt);
+        return;
+    }
+    ++depthChanges;
+    ordersDigest -= orderDigest(order); // Added back once it rests again
+
+    // Keep the filled amount (initial - open) unchanged
+    Quantity open = order.openQuantity();
+    order.initialQuantity = order.initialQuantity - open + newQuantity;
+
+    if (newPrice == order.price) {
+        level.totalVolume -= order.remainingQuantity;
+        level.openVolume = level.openVolume - open + newQuantity;
+        trackAuctionVolume(order.side, order.price, newQuantity, open);
+        if (newQuantity > open) {
+            // Size increase loses time priority
+            order.timestamp = currentTime;
+            order.remainingQuantity = newQuantity;
+            order.hiddenQuantity = 0;
+            order.hideReserve();
+            level.orders.splice(level.orders.end(), level.orders, loc.iterator);
+        } else {
+            // Reduce the hidden reserve first, then the displayed slice
+            order.remainingQuantity = std::min(order.remainingQuantity, newQuantity);
+            order.hiddenQuantity = newQuantity - order.remainingQuantity;
+        }
+        level.totalVolume += order.remainingQuantity;
+        ordersDigest += orderDigest(order);
+        report(order, ExecType::Replaced);
+        return;
+    }
+
+    // Price change: detach the node (iterators stay valid across splice),
+    // match it as a new aggressor, then rest the same node at the new level.
+    std::list<Order> moving;
+    moving.splice(moving.begin(), level.orders, loc.iterator);
+    level.totalVolume -= order.remainingQuantity;
+    level.openVolume -= open;
+    trackAuctionVolume(order.side, order.price, 0, open);
+    if (level.orders.empty()) {
+        book.erase(loc.price);
+    }
+
+    order.price = newPrice;
+    order.timestamp = currentTime;
+    order.remainingQuantity = newQuantity;
+    order.hiddenQuantity = 0;
+    report(order, ExecType::Replaced);
+    if (!auctionActive) {
+        matchAgainstBook(order, opposite, trades);
+    }
+
+    if (order.isFilled()) {
+        unlinkAccount(order);
+        orderLookup.erase(lookupIt);
+        orderClosed(order);
+        return;
+    }
+    order.hideReserve();
+
+    auto& newLevel = book[newPrice];
+    if (newLevel.totalVolume == 0) {
+        newLevel.price = newPrice; // Initialize if new
+    }
+    newLevel.totalVolume += order.remainingQuantity;
+    newLevel.openVolume += order.openQuantity();
+    trackAuctionVolume(order.side, newPrice, order.openQuantity(), 0);
+    newLevel.orders.splice(newLevel.orders.end(), moving);
+    ordersDigest += orderDigest(order);
+    loc.price = newPrice;
+    loc.level = &newLevel;
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::match(Order& incoming, std::vector<Trade>& trades) {
     if (incoming.side == Side::Buy) {
         matchAgainstBook(incoming, asks, trades);
     } else {
@@ -65,52 +403,118 @@ void OrderBook::match(Order& incoming, std::vector<Trade>& trades) {
     }
 }
 
+template<typename MatchPolicy>
 template<typename BookSide>
-void OrderBook::matchAgainstBook(Order& incoming, BookSide& book, std::vector<Trade>& trades) {
+void BasicOrderBook<MatchPolicy>::matchAgainstBook(Order& incoming, BookSide& book, std::vector<Trade>& trades) {
+    // Self-trade check is one compare per maker: orders without an account
+    // compare against a value no resting order carries.
+    const AccountId stpAccount = (incoming.account != kNoAccount) ? incoming.account : ~AccountId{0};
+
     auto it = book.begin();
     while (it != book.end() && !incoming.isFilled()) {
         Level& level = it->second;
         
-        // Price check
-        bool priceMatch = (incoming.side == Side::Buy) ? (incoming.price >= level.price) : (incoming.price <= level.price);
+        // Price check (market orders take any price)
+        bool priceMatch = (incoming.type == OrderType::Market) ||
+                          ((incoming.side == Side::Buy) ? (incoming.price >= level.price) : (incoming.price <= level.price));
         if (!priceMatch) break;
 
-        auto orderIt = level.orders.begin();
-        while (orderIt != level.orders.end() && !incoming.isFilled()) {
+        // Settles a maker whose displayed size was reduced: iceberg refresh,
+        // removal when done. Returns where to continue in the level's queue.
+        auto settle = [&](std::list<Order>::iterator orderIt) {
+            Order& bookOrder = *orderIt;
+            if (!bookOrder.isFilled()) {
+                return std::next(orderIt);
+            }
+            bool refreshed = false;
+            changeBooked(bookOrder, [&] {
+                refreshed = bookOrder.replenish();
+                if (refreshed) bookOrder.timestamp = currentTime;
+            });
+            if (refreshed) {
+                // Iceberg refresh: same node moves to the back of the queue,
+                // the lookup entry stays valid
+                level.totalVolume += bookOrder.remainingQuantity;
+                auto next = std::next(orderIt);
+                if (next == level.orders.end()) {
+                    return orderIt; // Already last, still has size
+                }
+                level.orders.splice(level.orders.end(), level.orders, orderIt);
+                return next;
+            }
+            return eraseResting(level, orderIt);
+        };
+
+        // The policy decides how much each maker gets; fill() books the trade
+        // and returns where to continue in the level's queue.
+        auto fill = [&](std::list<Order>::iterator orderIt, Quantity tradeQty) {
             Order& bookOrder = *orderIt;
-            
-            Quantity tradeQty = std::min(incoming.remainingQuantity, bookOrder.remainingQuantity);
-            
+
+            if (bookOrder.account == stpAccount) {
+                switch (incoming.stpMode) {
+                case StpMode::CancelNewest:
+                    report(incoming, ExecType::Canceled);
+                    incoming.remainingQuantity = 0;
+                    return orderIt;
+                case StpMode::CancelOldest:
+                    return eraseResting(level, orderIt);
+                case StpMode::CancelBoth:
+                    report(incoming, ExecType::Canceled);
+                    incoming.remainingQuantity = 0;
+                    return eraseResting(level, orderIt);
+                case StpMode::Decrement:
+                    // The overlap is cancelled, not filled, on both sides
+                    incoming.remainingQuantity -= tradeQty;
+                    incoming.initialQuantity -= tradeQty;
+                    changeBooked(bookOrder, [&] {
+                        bookOrder.remainingQuantity -= tradeQty;
+                        bookOrder.initialQuantity -= tradeQty;
+                    });
+                    level.totalVolume -= tradeQty;
+                    level.openVolume -= tradeQty;
+                    ++depthChanges;
+                    if (incoming.openQuantity() == 0) report(incoming, ExecType::Canceled);
+                    if (bookOrder.openQuantity() == 0) report(bookOrder, ExecType::Canceled);
+                    return settle(orderIt);
+                }
+            }
+
             trades.push_back({
                 level.price,
                 tradeQty,
                 bookOrder.id,
                 incoming.id,
-                std::chrono::system_clock::now()
+                currentTime
             });
 
             incoming.remainingQuantity -= tradeQty;
-            bookOrder.remainingQuantity -= tradeQty;
+            changeBooked(bookOrder, [&] { bookOrder.remainingQuantity -= tradeQty; });
             level.totalVolume -= tradeQty;
+            level.openVolume -= tradeQty;
+            ++depthChanges;
+            reportFill(incoming, level.price, tradeQty);
+            reportFill(bookOrder, level.price, tradeQty);
 
-            if (bookOrder.isFilled()) {
-                orderLookup.erase(bookOrder.id);
-                orderIt = level.orders.erase(orderIt);
-            } else {
-                ++orderIt;
-            }
-        }
+            return settle(orderIt);
+        };
+
+        MatchPolicy::matchLevel(level, incoming.remainingQuantity, fill);
 
         if (level.orders.empty()) {
             it = book.erase(it);
-        } else {
+        } else if (incoming.isFilled()) {
             ++it;
         }
+        // Otherwise the level only holds refreshed iceberg slices the policy
+        // did not revisit in this pass; allocate it again.
     }
 }
 
+template<typename MatchPolicy>
 template<typename BookSide>
-void OrderBook::addToBook(Order& order, BookSide& book) {
+void BasicOrderBook<MatchPolicy>::addToBook(Order& order, BookSide& book) {
+    order.hideReserve();
+
     auto& level = book[order.price];
     if (level.totalVolume == 0) {
         level.price = order.price; // Initialize if new
@@ -118,14 +522,441 @@ void OrderBook::addToBook(Order& order, BookSide& book) {
     
     level.orders.push_back(order);
     level.totalVolume += order.remainingQuantity;
+    level.openVolume += order.openQuantity();
+    ++depthChanges;
+    trackAuctionVolume(order.side, order.price, order.openQuantity(), 0);
     
     // Store iterator for lookup
     auto it = level.orders.end();
     --it;
-    orderLookup.insert({order.id, {order.side, order.price, it}});
+    linkAccount(*it);
+    ordersDigest += orderDigest(*it);
+    orderLookup.insert({order.id, {order.side, order.price, it, &level}});
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::startAuction() {
+    auctionActive = true;
+    resetAuctionAnchor();
+    updateIndicative();
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::resetAuctionAnchor() {
+    // At the best bid only that level counts as buy volume; the asks at or
+    // below it are the crossed ones (none, unless restored mid-auction)
+    anchor = {};
+    if (!bids.empty()) {
+        anchor.price = bids.begin()->first;
+        anchor.buy = bids.begin()->second.openVolume;
+        for (auto it = asks.begin(); it != asks.end() && it->first <= anchor.price; ++it) {
+            anchor.sell += it->second.openVolume;
+        }
+    } else if (!asks.empty()) {
+        anchor.price = asks.begin()->first;
+        anchor.sell = asks.begin()->second.openVolume;
+    }
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::trackAuctionVolume(Side side, Price price, Quantity added, Quantity removed) {
+    if (!auctionActive) return;
+    if (side == Side::Buy && price >= anchor.price) {
+        anchor.buy = anchor.buy + added - removed;
+    } else if (side == Side::Sell && price <= anchor.price) {
+        anchor.sell = anchor.sell + added - removed;
+    }
+}
+
+template<typename MatchPolicy>
+std::optional<Price> BasicOrderBook<MatchPolicy>::levelAbove(Price price) const {
+    std::optional<Price> next;
+    auto bidIt = bids.lower_bound(price); // First bid <= price
+    if (bidIt != bids.begin()) next = std::prev(bidIt)->first;
+    auto askIt = asks.upper_bound(price);
+    if (askIt != asks.end() && (!next || askIt->first < *next)) next = askIt->first;
+    return next;
+}
+
+template<typename MatchPolicy>
+std::optional<Price> BasicOrderBook<MatchPolicy>::levelBelow(Price price) const {
+    std::optional<Price> next;
+    auto bidIt = bids.upper_bound(price); // First bid < price
+    if (bidIt != bids.end()) next = bidIt->first;
+    auto askIt = asks.lower_bound(price);
+    if (askIt != asks.begin() && (!next || std::prev(askIt)->first > *next)) next = std::prev(askIt)->first;
+    return next;
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::updateIndicative() {
+    // Moving to the adjacent level: no level lies in between, so only the
+    // two end levels change the sums
+    auto up = [this](AuctionAnchor a, Price next) {
+        a.buy -= openVolumeAt(bids, a.price);
+        a.sell += openVolumeAt(asks, next);
+        a.price = next;
+        return a;
+    };
+    auto down = [this](AuctionAnchor a, Price next) {
+        a.buy += openVolumeAt(bids, next);
+        a.sell -= openVolumeAt(asks, a.price);
+        a.price = next;
+        return a;
+    };
+
+    // Onto a level (the anchor's own may be gone), keeping to its side of
+    // the sign change
+    if (bids.find(anchor.price) == bids.end() && asks.find(anchor.price) == asks.end()) {
+        auto below = levelBelow(anchor.price);
+        auto above = levelAbove(anchor.price);
+        if (below && (anchor.buy >= anchor.sell || !above)) {
+            anchor = down(anchor, *below);
+        } else if (above) {
+            anchor = up(anchor, *above);
+        } else {
+            indicative.reset();
+            return;
+        }
+    }
+
+    // To the highest level with buy >= sell, or the lowest level if none
+    if (anchor.buy >= anchor.sell) {
+        while (auto next = levelAbove(anchor.price)) {
+            AuctionAnchor moved = up(anchor, *next);
+            if (moved.buy < moved.sell) break;
+            anchor = moved;
+        }
+    } else {
+        while (anchor.buy < anchor.sell) {
+            auto next = levelBelow(anchor.price);
+            if (!next) break;
+            anchor = down(anchor, *next);
+        }
+    }
+
+    // Executable volume (then imbalance) only improves up to the anchor and
+    // only worsens past the level above it, so the best prices are one of
+    // the two plus any neighbours tying with it: the same range
+    // computeUncross() finds by scanning
+    auto volume = [](const AuctionAnchor& a) { return std::min(a.buy, a.sell); };
+    auto imbalance = [](const AuctionAnchor& a) { return (a.buy > a.sell) ? a.buy - a.sell : a.sell - a.buy; };
+    auto ties = [&](const AuctionAnchor& a, const AuctionAnchor& b) {
+        return volume(a) == volume(b) && imbalance(a) == imbalance(b);
+    };
+    AuctionAnchor lo = anchor;
+    if (anchor.buy >= anchor.sell) {
+        if (auto next = levelAbove(anchor.price)) {
+            AuctionAnchor above = up(anchor, *next);
+            if (volume(above) > volume(anchor) ||
+                (volume(above) == volume(anchor) && imbalance(above) < imbalance(anchor))) {
+                lo = above;
+            }
+        }
+    }
+    AuctionAnchor hi = lo;
+    while (auto next = levelBelow(lo.price)) {
+        AuctionAnchor moved = down(lo, *next);
+        if (!ties(moved, lo)) break;
+        lo = moved;
+    }
+    while (auto next = levelAbove(hi.price)) {
+        AuctionAnchor moved = up(hi, *next);
+        if (!ties(moved, hi)) break;
+        hi = moved;
+    }
+
+    if (volume(lo) == 0) {
+        indicative.reset();
+        return;
+    }
+    Price price = lastTradePrice ? std::clamp(*lastTradePrice, lo.price, hi.price)
+                                 : lo.price + (hi.price - lo.price) / 2;
+    indicative = AuctionInfo{price, volume(lo)};
+}
+
+template<typename MatchPolicy>
+std::optional<AuctionInfo> BasicOrderBook<MatchPolicy>::computeUncross() const {
+    if (bids.empty() || asks.empty()) return std::nullopt;
+    const Price bestBid = bids.begin()->first;
+    const Price bestAsk = asks.begin()->first;
+    if (bestBid < bestAsk) return std::nullopt;
+
+    // Volumes are open quantity: the uncross replenishes icebergs, so their
+    // reserves execute too. Crossed bids, walked in ascending price from the
+    // lowest one >= best ask.
+    auto bidEnd = bids.upper_bound(bestAsk);
+    Quantity buyVolume = 0;
+    for (auto it = bids.begin(); it != bidEnd; ++it) {
+        buyVolume += it->second.openVolume;
+    }
+    auto bidIt = std::make_reverse_iterator(bidEnd);
+    auto bidStop = bids.rend();
+    auto askIt = asks.begin();
+    auto askStop = asks.upper_bound(bestBid);
+
+    // Single ascending merge over candidate prices: sell volume (asks <= p)
+    // grows, buy volume (bids >= p) shrinks. Pick max executable volume,
+    // then min imbalance; exact ties are resolved towards the last trade
+    // price within the tied range.
+    Quantity sellVolume = 0;
+    Quantity bestVolume = 0;
+    Quantity bestImbalance = 0;
+    Price lo = 0, hi = 0;
+
+    while (bidIt != bidStop || askIt != askStop) {
+        Price p;
+        if (bidIt == bidStop) p = askIt->first;
+        else if (askIt == askStop) p = bidIt->first;
+        else p = std::min(bidIt->first, askIt->first);
+
+        if (askIt != askStop && askIt->first == p) {
+            sellVolume += askIt->second.openVolume;
+            ++askIt;
+        }
+
+        Quantity volume = std::min(buyVolume, sellVolume);
+        Quantity imbalance = (buyVolume > sellVolume) ? buyVolume - sellVolume : sellVolume - buyVolume;
+        if (volume > bestVolume || (volume == bestVolume && imbalance < bestImbalance)) {
+            bestVolume = volume;
+            bestImbalance = imbalance;
+            lo = hi = p;
+        } else if (volume == bestVolume && imbalance == bestImbalance && volume > 0) {
+            hi = p;
+        }
+
+        if (bidIt != bidStop && bidIt->first == p) {
+            buyVolume -= bidIt->second.openVolume;
+            ++bidIt;
+        }
+    }
+
+    if (bestVolume == 0) return std::nullopt;
+
+    Price price = lastTradePrice ? std::clamp(*lastTradePrice, lo, hi) : lo + (hi - lo) / 2;
+    return AuctionInfo{price, bestVolume};
+}
+
+template<typename MatchPolicy>
+std::vector<Trade> BasicOrderBook<MatchPolicy>::uncross() {
+    std::vector<Trade> trades;
+    if (!auctionActive) return trades;
+
+    auctionActive = false;
+    indicative.reset();
+
+    // Everything that crosses the uncross price trades at that price, in
+    // price-time priority on both sides. The earlier order is the maker; the
+    // later one takes the aggressor's part in self-trade prevention. Without
+    // STP one round leaves the book uncrossed; volume STP removed can leave a
+    // cross, which the next round clears at its own price.
+    while (auto result = computeUncross()) {
+        const Price price = result->price;
+        while (!bids.empty() && !asks.empty() &&
+               bids.begin()->first >= price && asks.begin()->first <= price) {
+            Order& bid = bids.begin()->second.orders.front();
+            Order& ask = asks.begin()->second.orders.front();
+            Quantity qty = std::min(bid.remainingQuantity, ask.remainingQuantity);
+            bool askIsMaker = (ask.timestamp < bid.timestamp) ||
+                              (ask.timestamp == bid.timestamp && ask.id < bid.id);
+
+            if (bid.account != kNoAccount && bid.account == ask.account) {
+                switch (askIsMaker ? bid.stpMode : ask.stpMode) {
+                case StpMode::CancelNewest:
+                    if (askIsMaker) cancelFront(bids); else cancelFront(asks);
+                    break;
+                case StpMode::CancelOldest:
+                    if (askIsMaker) cancelFront(asks); else cancelFront(bids);
+                    break;
+                case StpMode::CancelBoth:
+                    cancelFront(bids);
+                    cancelFront(asks);
+                    break;
+                case StpMode::Decrement:
+                    decrementFront(bids, qty);
+                    decrementFront(asks, qty);
+                    break;
+                }
+                continue;
+            }
+
+            trades.push_back({
+                price,
+                qty,
+                askIsMaker ? ask.id : bid.id,
+                askIsMaker ? bid.id : ask.id,
+                currentTime
+            });
+            fillFront(bids, price, qty);
+            fillFront(asks, price, qty);
+        }
+    }
+    assert(bids.empty() || asks.empty() || bids.begin()->first < asks.begin()->first);
+
+    processTriggers(trades);
+    return trades;
+}
+
+template<typename MatchPolicy>
+template<typename BookSide>
+void BasicOrderBook<MatchPolicy>::fillFront(BookSide& book, Price price, Quantity qty) {
+    Level& level = book.begin()->second;
+    Order& order = level.orders.front();
+    changeBooked(order, [&] { order.remainingQuantity -= qty; });
+    level.totalVolume -= qty;
+    level.openVolume -= qty;
+    ++depthChanges;
+    reportFill(order, price, qty);
+    settleFront(book);
+}
+
+template<typename MatchPolicy>
+template<typename BookSide>
+void BasicOrderBook<MatchPolicy>::decrementFront(BookSide& book, Quantity qty) {
+    // As in continuous matching: the overlap is cancelled, not filled
+    Level& level = book.begin()->second;
+    Order& order = level.orders.front();
+    changeBooked(order, [&] {
+        order.remainingQuantity -= qty;
+        order.initialQuantity -= qty;
+    });
+    level.totalVolume -= qty;
+    level.openVolume -= qty;
+    ++depthChanges;
+    if (order.openQuantity() == 0) report(order, ExecType::Canceled);
+    settleFront(book);
+}
+
+template<typename MatchPolicy>
+template<typename BookSide>
+void BasicOrderBook<MatchPolicy>::cancelFront(BookSide& book) {
+    auto levelIt = book.begin();
+    Level& level = levelIt->second;
+    eraseResting(level, level.orders.begin());
+    if (level.orders.empty()) {
+        book.erase(levelIt);
+    }
+}
+
+template<typename MatchPolicy>
+template<typename BookSide>
+void BasicOrderBook<MatchPolicy>::settleFront(BookSide& book) {
+    auto levelIt = book.begin();
+    Level& level = levelIt->second;
+    auto orderIt = level.orders.begin();
+    if (!orderIt->isFilled()) return;
+
+    bool refreshed = false;
+    changeBooked(*orderIt, [&] {
+        refreshed = orderIt->replenish();
+        if (refreshed) orderIt->timestamp = currentTime;
+    });
+    if (refreshed) {
+        level.totalVolume += orderIt->remainingQuantity;
+        level.orders.splice(level.orders.end(), level.orders, orderIt);
+        return;
+    }
+    eraseResting(level, orderIt);
+    if (level.orders.empty()) {
+        book.erase(levelIt);
+    }
 }
 
-std::vector<LevelInfo> OrderBook::getBids() const {
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::restoreOrder(const Order& order) {
+    Order copy = order;
+    copy.accountPrev = copy.accountNext = nullptr;
+    if (copy.type == OrderType::Stop || copy.type == OrderType::StopLimit) {
+        addStop(copy);
+        return;
+    }
+
+    auto append = [&](auto& book) {
+        // Input is in priority order, so the level is the last one (or new)
+        auto levelIt = book.emplace_hint(book.end(), copy.price, Level(copy.price));
+        Level& level = levelIt->second;
+        level.orders.push_back(copy);
+        level.totalVolume += copy.remainingQuantity;
+        level.openVolume += copy.openQuantity();
+        ++depthChanges;
+
+        auto it = std::prev(level.orders.end());
+        linkAccount(*it);
+        ordersDigest += orderDigest(*it);
+        orderLookup.insert({copy.id, {copy.side, copy.price, it, &level}});
+    };
+    if (copy.side == Side::Buy) {
+        append(bids);
+    } else {
+        append(asks);
+    }
+}
+
+template<typename MatchPolicy>
+void BasicOrderBook<MatchPolicy>::restoreState(std::optional<Price> lastTrade, bool auction) {
+    lastTradePrice = lastTrade;
+    auctionActive = auction;
+    indicative.reset();
+    if (auction) {
+        resetAuctionAnchor();
+        updateIndicative();
+    }
+}
+
+template<typename MatchPolicy>
+uint64_t BasicOrderBook<MatchPolicy>::orderDigest(const Order& order) {
+    // FNV-1a over 64-bit words, then a finalizer so that summing the
+    // per-order values does not leave them linear in any one field
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint64_t word) {
+        hash ^= word;
+        hash *= 0x100000001b3ull;
+    };
+    mix(order.id);
+    mix(static_cast<uint64_t>(order.side) | static_cast<uint64_t>(order.type) << 8 |
+        static_cast<uint64_t>(order.stpMode) << 16 | static_cast<uint64_t>(order.timeInForce) << 24);
+    mix(order.price);
+    mix(order.stopPrice);
+    mix(order.account);
+    mix(order.initialQuantity);
+    mix(order.remainingQuantity);
+    mix(order.displayQuantity);
+    mix(order.hiddenQuantity);
+    mix(static_cast<uint64_t>(order.timestamp.time_since_epoch().count()));
+    mix(static_cast<uint64_t>(order.expireAt.time_since_epoch().count()));
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+template<typename MatchPolicy>
+uint64_t BasicOrderBook<MatchPolicy>::finishStateHash(uint64_t orders) const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint64_t word) {
+        hash ^= word;
+        hash *= 0x100000001b3ull;
+    };
+    mix(orders);
+    mix(lastTradePrice ? *lastTradePrice : ~0ull);
+    mix(auctionActive);
+    return hash;
+}
+
+template<typename MatchPolicy>
+uint64_t BasicOrderBook<MatchPolicy>::stateHash() const {
+    return finishStateHash(ordersDigest);
+}
+
+template<typename MatchPolicy>
+uint64_t BasicOrderBook<MatchPolicy>::recomputeStateHash() const {
+    uint64_t orders = 0;
+    visitOrders([&orders](const Order& order) { orders += orderDigest(order); });
+    return finishStateHash(orders);
+}
+
+template<typename MatchPolicy>
+std::vector<LevelInfo> BasicOrderBook<MatchPolicy>::getBids() const {
     std::vector<LevelInfo> levels;
     for (const auto& [price, level] : bids) {
         levels.push_back({price, level.totalVolume});
@@ -133,7 +964,8 @@ std::vector<LevelInfo> OrderBook::getBids() const {
     return levels;
 }
 
-std::vector<LevelInfo> OrderBook::getAsks() const {
+template<typename MatchPolicy>
+std::vector<LevelInfo> BasicOrderBook<MatchPolicy>::getAsks() const {
     std::vector<LevelInfo> levels;
     for (const auto& [price, level] : asks) {
         levels.push_back({price, level.totalVolume});
@@ -141,4 +973,8 @@ std::vector<LevelInfo> OrderBook::getAsks() const {
     return levels;
 }
 
+template class BasicOrderBook<FifoPolicy>;
+template class BasicOrderBook<ProRataPolicy>;
+template class BasicOrderBook<TopOrderProRataPolicy<>>;
+
 } // namespace ome
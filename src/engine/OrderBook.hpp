@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common/types.hpp"
+#include "common/Clock.hpp"
+#include "MatchingPolicy.hpp"
 #include <map>
 #include <unordered_map>
 #include <list>
@@ -17,25 +19,109 @@ struct OrderEntry {
 
 struct Level {
     Price price;
-    Quantity totalVolume;
+    Quantity totalVolume;   // Displayed
+    Quantity openVolume;    // Displayed plus iceberg reserves
     std::list<Order> orders;
 
-    Level() : price(0), totalVolume(0) {}
-    Level(Price p) : price(p), totalVolume(0) {}
+    Level() : price(0), totalVolume(0), openVolume(0) {}
+    Level(Price p) : price(p), totalVolume(0), openVolume(0) {}
 };
 
-class OrderBook {
+// Limit order book. MatchPolicy decides how an aggressor is allocated across
+// the orders of one price level (see MatchingPolicy.hpp); price priority
+// across levels is always strict.
+template<typename MatchPolicy = FifoPolicy>
+class BasicOrderBook {
 public:
-    OrderBook();
+    using OrderClosedCallback = std::function<void(const Order&)>;
 
-    // Returns trades generated
+    BasicOrderBook();
+
+    // Returns trades generated, including those of any stops it triggers.
+    // Market orders never rest; Stop/StopLimit orders wait in the trigger
+    // book until the last trade price reaches their stop price.
     std::vector<Trade> addOrder(Order order);
-    bool cancelOrder(OrderId orderId);
+    bool cancelOrder(OrderId orderId) { return removeOrder(orderId, ExecType::Canceled); }
+    // Same as cancelOrder, reported as Expired
+    bool expireOrder(OrderId orderId) { return removeOrder(orderId, ExecType::Expired); }
+    // True if the order is resting or is a pending stop
+    bool hasOrder(OrderId orderId) const {
+        return orderLookup.count(orderId) > 0 || stopLookup.count(orderId) > 0;
+    }
+
+    // Cancels the selected orders of one account by walking that account's
+    // own order list; cost is proportional to its order count. Returns the
+    // number of orders cancelled.
+    size_t massCancel(const MassCancelRequest& request);
+
+    // Amends a resting order; pending stops cannot be amended. newQuantity is
+    // the new open quantity (0 cancels). A quantity reduction at the same
+    // price keeps time priority; an increase moves the order to the back of
+    // its level. A price change moves the order node to the new level in one
+    // step, matching first if it now crosses. Either move restamps the
+    // order's timestamp. Returns false if the order is unknown.
+    bool modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity, std::vector<Trade>& trades);
     
-    // Getters for GUI
+    // Time stamped on every order and trade until the next call; the engine
+    // sets it once per command
+    void setTime(Timestamp now) { currentTime = now; }
+
+    // Called once for every accepted order as it leaves the book for good:
+    // filled, cancelled, expired, removed by STP, or dropped without resting
+    // (market remainder, duplicate id). Triggering a stop does not close it.
+    void setOrderClosedCallback(OrderClosedCallback cb) { onOrderClosed = std::move(cb); }
+
+    // Execution reports for every order event are appended here when set;
+    // the owner drains the vector. nullptr (default) skips them entirely.
+    void setReportSink(std::vector<ExecutionReport>* sink) { reportSink = sink; }
+
+    // Call auction. While active, orders rest without matching and the book
+    // may cross; market orders are not accepted. uncross() executes all
+    // crossing volume (iceberg reserves included) at the single price that
+    // maximises it, applying self-trade prevention, and returns to continuous
+    // matching with the book uncrossed.
+    void startAuction();
+    std::vector<Trade> uncross();
+    bool inAuction() const { return auctionActive; }
+    std::optional<AuctionInfo> getIndicative() const { return indicative; }
+
+    // Top of book, O(1)
+    std::optional<Price> bestBid() const {
+        return bids.empty() ? std::nullopt : std::optional<Price>(bids.begin()->first);
+    }
+    std::optional<Price> bestAsk() const {
+        return asks.empty() ? std::nullopt : std::optional<Price>(asks.begin()->first);
+    }
+
+    // Getters for GUI (displayed quantity only; iceberg reserves are hidden)
     std::vector<LevelInfo> getBids() const;
     std::vector<LevelInfo> getAsks() const;
 
+    // Snapshot support. visitOrders() walks resting orders level by level in
+    // priority order (bids, then asks), then pending stops in trigger order.
+    template<typename Fn>
+    void visitOrders(Fn&& fn) const;
+    // Bulk load into an empty book: appends the order to the back of its
+    // level or stop queue without matching. Orders must arrive in the order
+    // visitOrders() produced them, so levels are appended at the map's end.
+    void restoreOrder(const Order& order);
+    void restoreState(std::optional<Price> lastTrade, bool auction);
+    void reserve(size_t orders) { orderLookup.reserve(orders); }
+    std::optional<Price> getLastTradePrice() const { return lastTradePrice; }
+    size_t orderCount() const { return orderLookup.size() + stopLookup.size(); }
+    size_t levelCount(Side side) const { return side == Side::Buy ? bids.size() : asks.size(); }
+    // Bumped by every change to resting depth (pending stops are not depth),
+    // so the owner can tell whether a command left the visible book alone
+    uint64_t depthVersion() const { return depthChanges; }
+    // Digest of everything matching depends on (every order's fields, last
+    // trade, auction state) for comparing replicas. Queue order shows through
+    // the timestamps, which are restamped whenever an order is requeued.
+    // Sessions are left out; they do not survive a restart either. O(1): the
+    // per-order part is kept up to date as orders change.
+    uint64_t stateHash() const;
+    // The same digest from scratch, O(orders); for checking stateHash()
+    uint64_t recomputeStateHash() const;
+
 private:
     // Bids: Highest price first
     std::map<Price, Level, std::greater<Price>> bids;
@@ -47,17 +133,143 @@ private:
         Side side;
         Price price;
         std::list<Order>::iterator iterator;
+        Level* level; // Map nodes are stable until the level is erased
     };
     std::unordered_map<OrderId, OrderLocation> orderLookup;
+    using LookupIterator = typename std::unordered_map<OrderId, OrderLocation>::iterator;
+
+    // Trigger book: pending stops by stop price, FIFO within a price.
+    // Buy stops fire when the last trade is at or above the stop price (lowest
+    // first), sell stops when it is at or below (highest first).
+    std::map<Price, std::list<Order>, std::less<Price>> buyStops;
+    std::map<Price, std::list<Order>, std::greater<Price>> sellStops;
+
+    struct StopLocation {
+        Side side;
+        Price stopPrice;
+        std::list<Order>::iterator iterator;
+    };
+    std::unordered_map<OrderId, StopLocation> stopLookup;
+
+    // Head (newest) of each account's intrusive order list
+    std::unordered_map<AccountId, Order*> accountOrders;
+
+    std::optional<Price> lastTradePrice;
+    uint64_t depthChanges = 0;
+    uint64_t ordersDigest = 0; // Sum of orderDigest() over resting orders and stops
+
+    Timestamp currentTime{};
+
+    bool auctionActive = false;
+    std::optional<AuctionInfo> indicative;
+    // During the call: the open volume of bids at or above `price` and of
+    // asks at or below it, kept in step with every level change
+    struct AuctionAnchor {
+        Price price = 0;
+        Quantity buy = 0;
+        Quantity sell = 0;
+    };
+    AuctionAnchor anchor;
+
+    OrderClosedCallback onOrderClosed;
+    std::vector<ExecutionReport>* reportSink = nullptr;
 
     // Helpers
+    void execute(Order& order, std::vector<Trade>& trades);
     void match(Order& incoming, std::vector<Trade>& trades);
+    void processTriggers(std::vector<Trade>& trades);
+    void collectTriggered(std::vector<Order>& triggered);
+    bool isTriggered(const Order& stop) const;
+    void addStop(Order& order);
     
     template<typename BookSide>
     void matchAgainstBook(Order& incoming, BookSide& book, std::vector<Trade>& trades);
     
     template<typename BookSide>
     void addToBook(Order& order, BookSide& book);
+
+    bool removeOrder(OrderId orderId, ExecType reason);
+    bool cancelStop(OrderId orderId, ExecType reason = ExecType::Canceled);
+    void cancelResting(LookupIterator lookupIt, ExecType reason = ExecType::Canceled);
+    std::list<Order>::iterator eraseResting(Level& level, std::list<Order>::iterator orderIt,
+                                            ExecType reason = ExecType::Canceled);
+    void linkAccount(Order& order);
+    void unlinkAccount(Order& order);
+
+    static uint64_t orderDigest(const Order& order);
+    uint64_t finishStateHash(uint64_t orders) const;
+    // Applies `change` to an order in the book, keeping ordersDigest in step
+    template<typename Fn>
+    void changeBooked(Order& order, Fn&& change) {
+        ordersDigest -= orderDigest(order);
+        change();
+        ordersDigest += orderDigest(order);
+    }
+
+    void report(const Order& order, ExecType type, Price lastPrice = 0, Quantity lastQuantity = 0);
+    void reportFill(const Order& order, Price price, Quantity qty) {
+        report(order, order.openQuantity() ? ExecType::PartialFill : ExecType::Fill, price, qty);
+    }
+    // Orders closed with open quantity left are reported with `reason`; a
+    // fill has already been reported by the time its order closes
+    void orderClosed(const Order& order, ExecType reason = ExecType::Canceled) {
+        if (order.openQuantity() > 0) report(order, reason);
+        if (onOrderClosed) onOrderClosed(order);
+    }
+
+    // Indicative uncross, maintained incrementally. Buy minus sell volume
+    // at a price only falls as the price rises, and the equilibrium is where
+    // it changes sign; updateIndicative() walks the anchor there level by
+    // level from wherever the last change left it.
+    void resetAuctionAnchor();
+    void trackAuctionVolume(Side side, Price price, Quantity added, Quantity removed);
+    void updateIndicative();
+    // Nearest level price strictly above / below `price`, either side
+    std::optional<Price> levelAbove(Price price) const;
+    std::optional<Price> levelBelow(Price price) const;
+    // Full scan, for the uncross itself
+    std::optional<AuctionInfo> computeUncross() const;
+
+    // Uncross steps on the first order of the best level
+    template<typename BookSide>
+    void fillFront(BookSide& book, Price price, Quantity qty);
+    template<typename BookSide>
+    void decrementFront(BookSide& book, Quantity qty);
+    template<typename BookSide>
+    void cancelFront(BookSide& book);
+    // Refreshes or removes the first order once its displayed size is gone
+    template<typename BookSide>
+    void settleFront(BookSide& book);
+
+    template<typename BookSide, typename OppositeSide>
+    void modifyInBook(LookupIterator lookupIt,
+                      Price newPrice, Quantity newQuantity,
+                      BookSide& book, OppositeSide& opposite, std::vector<Trade>& trades);
 };
 
+template<typename MatchPolicy>
+template<typename Fn>
+void BasicOrderBook<MatchPolicy>::visitOrders(Fn&& fn) const {
+    for (const auto& [price, level] : bids) {
+        for (const Order& order : level.orders) fn(order);
+    }
+    for (const auto& [price, level] : asks) {
+        for (const Order& order : level.orders) fn(order);
+    }
+    for (const auto& [price, queue] : buyStops) {
+        for (const Order& order : queue) fn(order);
+    }
+    for (const auto& [price, queue] : sellStops) {
+        for (const Order& order : queue) fn(order);
+    }
+}
+
+// Instantiated in OrderBook.cpp for the policies in MatchingPolicy.hpp
+extern template class BasicOrderBook<FifoPolicy>;
+extern template class BasicOrderBook<ProRataPolicy>;
+extern template class BasicOrderBook<TopOrderProRataPolicy<>>;
+
+using OrderBook = BasicOrderBook<FifoPolicy>;
+using ProRataOrderBook = BasicOrderBook<ProRataPolicy>;
+
 } // namespace ome
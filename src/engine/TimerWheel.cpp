@@ -0,0 +1,131 @@
+#include "TimerWheel.hpp"
+#include <algorithm>
+
+namespace ome {
+
+TimerWheel::TimerWheel(Clock::time_point start, Clock::duration tick)
+    : tick(tick), currentTick(toTick(start)) {}
+
+uint64_t TimerWheel::toTick(Clock::time_point tp) const {
+    auto sinceEpoch = tp.time_since_epoch();
+    if (sinceEpoch.count() <= 0) return 0;
+    return static_cast<uint64_t>(sinceEpoch / tick);
+}
+
+void TimerWheel::schedule(OrderId orderId, Clock::time_point deadline) {
+    cancel(orderId);
+
+    uint64_t due = std::max(toTick(deadline), currentTick + 1);
+    auto [it, inserted] = timers.try_emplace(orderId, Timer{orderId, due, 0, nullptr, nullptr});
+    insert(it->second);
+}
+
+bool TimerWheel::cancel(OrderId orderId) {
+    auto it = timers.find(orderId);
+    if (it == timers.end()) return false;
+
+    unlink(it->second);
+    timers.erase(it);
+    return true;
+}
+
+void TimerWheel::insert(Timer& timer) {
+    // Level by distance, slot by the deadline's bits at that level
+    uint64_t delta = timer.deadline - currentTick;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t{1} << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+    uint64_t slot = (timer.deadline >> (kSlotBits * level)) & kSlotMask;
+
+    Timer*& head = slots[level][slot];
+    timer.level = level;
+    timer.prev = nullptr;
+    timer.next = head;
+    if (head) head->prev = &timer;
+    head = &timer;
+    ++levelCount[level];
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    if (timer.prev) {
+        timer.prev->next = timer.next;
+    } else {
+        uint64_t slot = (timer.deadline >> (kSlotBits * timer.level)) & kSlotMask;
+        slots[timer.level][slot] = timer.next;
+    }
+    if (timer.next) timer.next->prev = timer.prev;
+    --levelCount[timer.level];
+}
+
+void TimerWheel::cascade(int level) {
+    uint64_t slot = (currentTick >> (kSlotBits * level)) & kSlotMask;
+    Timer* timer = slots[level][slot];
+    slots[level][slot] = nullptr;
+    while (timer) {
+        Timer* next = timer->next;
+        --levelCount[level];
+        insert(*timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::step(std::vector<OrderId>& expired) {
+    ++currentTick;
+
+    // Refill lower levels from the coarser ones at each wrap
+    for (int level = 1; level < kLevels; ++level) {
+        if ((currentTick >> (kSlotBits * (level - 1))) & kSlotMask) break;
+        cascade(level);
+    }
+
+    uint64_t slot = currentTick & kSlotMask;
+    Timer* timer = slots[0][slot];
+    slots[0][slot] = nullptr;
+    while (timer) {
+        Timer* next = timer->next;
+        --levelCount[0];
+        expired.push_back(timer->orderId);
+        timers.erase(timer->orderId);
+        timer = next;
+    }
+}
+
+void TimerWheel::advance(Clock::time_point now, std::vector<OrderId>& expired) {
+    uint64_t target = toTick(now);
+
+    while (currentTick < target) {
+        if (timers.empty()) {
+            currentTick = target;
+            break;
+        }
+        if (levelCount[0] == 0) {
+            // Nothing can fire before the next level-0 wrap; jump to it
+            uint64_t wrap = (currentTick | kSlotMask) + 1;
+            if (wrap > target) {
+                currentTick = target;
+                break;
+            }
+            currentTick = wrap - 1;
+        }
+        step(expired);
+    }
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::nextWakeup() const {
+    if (timers.empty()) return std::nullopt;
+
+    uint64_t wrap = (currentTick | kSlotMask) + 1;
+    uint64_t wake = wrap;
+    if (levelCount[0] > 0) {
+        for (uint64_t t = currentTick + 1; t < wrap; ++t) {
+            if (slots[0][t & kSlotMask]) {
+                wake = t;
+                break;
+            }
+        }
+    }
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(tick * wake));
+}
+
+} // namespace ome
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "common/types.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace ome {
+
+// Hashed hierarchical timer wheel for order expiry, owned by the engine thread.
+//
+// Four levels of 256 slots at a 1 ms tick cover ~49 days; longer deadlines
+// park in the top level and are re-filed each time it cascades. Each timer is
+// an intrusive node indexed by OrderId, so schedule and cancel are O(1) and
+// advance() costs O(expired + ticks elapsed / 256) when idle.
+class TimerWheel {
+public:
+    using Clock = std::chrono::system_clock;
+
+    explicit TimerWheel(Clock::time_point start,
+                        Clock::duration tick = std::chrono::milliseconds(1));
+
+    // Deadlines at or before the current tick fire on the next advance()
+    void schedule(OrderId orderId, Clock::time_point deadline);
+    bool cancel(OrderId orderId);
+
+    // Moves time forward to `now`, appending every expired order id
+    void advance(Clock::time_point now, std::vector<OrderId>& expired);
+
+    // Latest time the owner may sleep until before calling advance() again
+    std::optional<Clock::time_point> nextWakeup() const;
+
+    size_t size() const { return timers.size(); }
+    bool empty() const { return timers.empty(); }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 8;
+    static constexpr uint64_t kSlots = 1u << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+
+    struct Timer {
+        OrderId orderId;
+        uint64_t deadline; // In ticks
+        int level;
+        Timer* prev;
+        Timer* next;
+    };
+
+    uint64_t toTick(Clock::time_point tp) const;
+    void insert(Timer& timer);
+    void unlink(Timer& timer);
+    void cascade(int level);
+    void step(std::vector<OrderId>& expired);
+
+    Clock::duration tick;
+    uint64_t currentTick;
+    std::array<std::array<Timer*, kSlots>, kLevels> slots{};
+    std::array<size_t, kLevels> levelCount{};
+    std::unordered_map<OrderId, Timer> timers; // Owns the nodes; addresses are stable
+};
+
+} // namespace ome
@@ -1,58 +1,324 @@
 #include "engine/MatchingEngine.hpp"
 #include "server/Server.hpp"
+#include "risk/RiskManager.hpp"
+#include "persistence/Journal.hpp"
+#include "replication/Replication.hpp"
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <thread>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
-int main() {
+namespace {
+
+std::atomic<bool> promoteRequested{false};
+
+void requestPromotion(int) {
+    promoteRequested.store(true, std::memory_order_relaxed);
+}
+
+// The next HH:MM (UTC) after now, for --session-close
+std::optional<ome::Timestamp> nextSessionClose(const std::string& value) {
+    unsigned hours = 0;
+    unsigned minutes = 0;
+    char extra = 0;
+    if (std::sscanf(value.c_str(), "%u:%u%c", &hours, &minutes, &extra) != 2 || hours > 23 || minutes > 59) {
+        return std::nullopt;
+    }
+    const auto now = std::chrono::system_clock::now();
+    ome::Timestamp close = std::chrono::floor<std::chrono::days>(now) + std::chrono::hours(hours) +
+                           std::chrono::minutes(minutes);
+    if (close <= now) close += std::chrono::days(1);
+    return close;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--journal PATH] [--durability buffered|async|sync]"
+              << " [--snapshot PATH] [--snapshot-every COMMANDS]"
+              << " [--replicate RING] [--follow RING] [--checkpoint-every COMMANDS]"
+              << " [--latency-every SECONDS] [--session-close HH:MM] [--clock system|tsc]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // ome [--journal PATH] [--durability buffered|async|sync]
+    //     [--snapshot PATH] [--snapshot-every COMMANDS]
+    //     [--replicate RING] [--follow RING] [--checkpoint-every COMMANDS]
+    //     [--latency-every SECONDS] [--session-close HH:MM] [--clock system|tsc]
+    std::string journalPath;
+    std::string snapshotPath;
+    uint64_t snapshotEvery = 1'000'000;
+    std::string replicateRing;
+    std::string followRing;
+    uint64_t checkpointEvery = 100'000;
+    unsigned latencyEvery = 0;
+    std::optional<ome::Timestamp> sessionClose;
+    bool tscClock = false;
+    ome::Durability durability = ome::Durability::Async;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--journal" && i + 1 < argc) {
+            journalPath = argv[++i];
+        } else if (arg == "--durability" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "buffered") {
+                durability = ome::Durability::Buffered;
+            } else if (mode == "sync") {
+                durability = ome::Durability::Sync;
+            } else if (mode == "async") {
+                durability = ome::Durability::Async;
+            } else {
+                // A typo must not quietly weaken durability
+                std::cerr << "--durability takes buffered, async or sync" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if (arg == "--snapshot-every" && i + 1 < argc) {
+            snapshotEvery = std::stoull(argv[++i]);
+        } else if (arg == "--replicate" && i + 1 < argc) {
+            replicateRing = argv[++i];
+        } else if (arg == "--follow" && i + 1 < argc) {
+            followRing = argv[++i];
+        } else if (arg == "--checkpoint-every" && i + 1 < argc) {
+            checkpointEvery = std::stoull(argv[++i]);
+        } else if (arg == "--latency-every" && i + 1 < argc) {
+            latencyEvery = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--clock" && i + 1 < argc) {
+            std::string source = argv[++i];
+            if (source != "system" && source != "tsc") {
+                std::cerr << "--clock takes system or tsc" << std::endl;
+                return 1;
+            }
+            tscClock = (source == "tsc");
+        } else if (arg == "--session-close" && i + 1 < argc) {
+            sessionClose = nextSessionClose(argv[++i]);
+            if (!sessionClose) {
+                std::cerr << "--session-close takes HH:MM (UTC)" << std::endl;
+                return 1;
+            }
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
     try {
-        ome::MatchingEngine engine;
+        ome::RiskManager risk;
+        ome::LatencyRecorder latency; // Outlives the engine and server
+        ome::Metrics metrics; // Likewise
+        std::unique_ptr<ome::Journal> journal; // Outlives the engine
+        std::unique_ptr<ome::ReplicationPublisher> publisher; // Likewise
+        // The engine stamps each command from this clock. The TSC one saves
+        // the vDSO call per command; it is calibrated here, against
+        // system_clock, and extrapolates from then on.
+        std::shared_ptr<ome::EngineClock> clock;
+        if (tscClock) {
+            auto tsc = std::make_shared<ome::TscClock>(std::chrono::milliseconds(200));
+            if (tsc->nanosecondsPerTick() > 0) {
+                std::cout << "TSC clock calibrated at " << 1.0 / tsc->nanosecondsPerTick() << " ticks/ns" << std::endl;
+            } else {
+                std::cout << "No usable TSC; the engine clock falls back to system_clock" << std::endl;
+            }
+            clock = tsc;
+        } else {
+            clock = std::make_shared<ome::SystemClock>();
+        }
+        ome::MatchingEngine engine(clock);
         ome::Server server(8080, engine);
 
-        // Wire up callbacks
-        engine.setTradeCallback([&server](const std::vector<ome::Trade>& trades) {
+        // Pre-trade risk on the ingress thread; the engine hands back open
+        // order slots and the collar reference
+        server.setRiskManager(&risk);
+        engine.setOrderClosedCallback([&risk](const ome::Order& order) {
+            risk.onOrderClosed(order.account);
+        });
+
+        // Rebuild the book before anything can connect: the latest snapshot,
+        // then the journal after it, then (as a follower) the primary's live
+        // stream. Recovered orders belong to no session; risk counts them as
+        // open.
+        ome::OrderId lastOrderId = 0;
+        auto recoverRecord = [&](ome::JournalRecord& record) {
+            if (record.command.type == ome::Command::Add) {
+                record.command.order->session = ome::kNoSession;
+                risk.restoreOpenOrder(record.command.order->account);
+                lastOrderId = std::max(lastOrderId, record.command.order->id);
+            }
+            engine.recover(record);
+        };
+
+        uint64_t snapshotSequence = 0;
+        if (!snapshotPath.empty()) {
+            auto started = std::chrono::steady_clock::now();
+            if (auto restored = engine.restoreSnapshot(snapshotPath)) {
+                snapshotSequence = *restored;
+                auto& book = engine.getOrderBook();
+                book.visitOrders([&](const ome::Order& order) {
+                    risk.restoreOpenOrder(order.account);
+                    lastOrderId = std::max(lastOrderId, order.id);
+                });
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - started);
+                std::cout << "Loaded " << book.orderCount() << " orders from snapshot at sequence "
+                          << snapshotSequence << " in " << elapsed.count() << " ms" << std::endl;
+            }
+            engine.setSnapshotPolicy(snapshotPath, snapshotEvery);
+        }
+
+        if (!journalPath.empty()) {
+            size_t recovered = ome::Journal::replay(journalPath, recoverRecord, nullptr, snapshotSequence);
+            std::cout << "Replayed " << recovered << " journaled commands" << std::endl;
+        }
+
+        // A follower reads the primary's journal but must not open it for
+        // writing until it takes over
+        if (!followRing.empty()) {
+            ome::ReplicationFollower follower(followRing);
+            std::signal(SIGUSR1, requestPromotion);
+            std::cout << "Following " << followRing << " from sequence " << engine.lastSequence()
+                      << " (SIGUSR1 to promote)" << std::endl;
+
+            auto result = follower.follow(engine.lastSequence(), recoverRecord,
+                                          [&engine] { return engine.getOrderBook().stateHash(); },
+                                          promoteRequested);
+            if (result != ome::ReplicationFollower::Result::Promoted) {
+                std::cerr << "Replication stopped: " << ome::toString(result) << std::endl;
+                return 1;
+            }
+            auto promoted = std::chrono::steady_clock::now();
+
+            // Line the journal up with the book: commands it made durable
+            // that never reached the ring are applied, and commands applied
+            // here that it never made durable are appended
+            if (!journalPath.empty()) {
+                journal = std::make_unique<ome::Journal>(journalPath, durability);
+                const uint64_t logged = journal->lastSequence();
+                if (logged > engine.lastSequence()) {
+                    ome::Journal::replay(journalPath, recoverRecord, nullptr, engine.lastSequence());
+                } else {
+                    for (const auto& record : follower.undurable()) {
+                        if (record.sequence > logged) {
+                            journal->append(record.sequence, record.timestamp, record.command);
+                        }
+                    }
+                }
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - promoted);
+            std::cout << "Promoted at sequence " << engine.lastSequence() << " in "
+                      << elapsed.count() << " us" << std::endl;
+        } else if (!journalPath.empty()) {
+            journal = std::make_unique<ome::Journal>(journalPath, durability);
+        }
+        if (journal) {
+            engine.setJournal(journal.get());
+        }
+        if (!replicateRing.empty()) {
+            publisher = std::make_unique<ome::ReplicationPublisher>(replicateRing, 64u << 20, checkpointEvery);
+            publisher->setJournal(journal.get());
+            engine.setReplication(publisher.get());
+        }
+        ome::Server::setNextOrderId(lastOrderId + 1);
+        // Day orders expire at the close; without one they are rejected
+        if (sessionClose) {
+            engine.setSessionClose(*sessionClose);
+        }
+
+        // Stage latencies, frame in to bytes out; recording costs a few ns.
+        // Both, with per-thread counters, are served at GET /metrics.
+        engine.setLatencyRecorder(&latency);
+        server.setLatencyRecorder(&latency);
+        engine.setMetrics(&metrics);
+        server.setMetrics(&metrics);
+
+        // Wire up callbacks. The public feed gets one print per aggressor per
+        // level; per-maker fills stay off the broadcast.
+        engine.setTradePrintCallback([&server, &risk](const std::vector<ome::TradePrint>& prints) {
+            risk.onTrade(prints.back().price);
             json j;
             j["type"] = "trade";
             std::vector<json> tradeList;
-            for (const auto& t : trades) {
+            for (const auto& p : prints) {
                 tradeList.push_back({
-                    {"price", t.price},
-                    {"qty", t.quantity},
-                    {"maker", t.makerOrderId},
-                    {"taker", t.takerOrderId}
+                    {"price", p.price},
+                    {"qty", p.quantity},
+                    {"makers", p.makerCount},
+                    {"taker", p.takerOrderId}
                 });
             }
             j["trades"] = tradeList;
             server.broadcast(j.dump());
         });
 
-        engine.setBookUpdateCallback([&server, &engine]() {
+        // Acks and fills go privately to the connection that owns the order
+        engine.setExecutionReportCallback([&server](const std::vector<ome::ExecutionReport>& reports) {
+            server.sendExecutionReports(reports);
+        });
+
+        engine.setBookUpdateCallback([&server, &engine, &risk]() {
             auto& book = engine.getOrderBook();
             json j;
             j["type"] = "book";
             
+            auto bidLevels = book.getBids();
+            auto askLevels = book.getAsks();
+            risk.onQuote(bidLevels.empty() ? 0 : bidLevels.front().price,
+                         askLevels.empty() ? 0 : askLevels.front().price);
+
             std::vector<json> bids, asks;
-            for (const auto& level : book.getBids()) {
+            for (const auto& level : bidLevels) {
                 bids.push_back({{"price", level.price}, {"qty", level.quantity}});
             }
-            for (const auto& level : book.getAsks()) {
+            for (const auto& level : askLevels) {
                 asks.push_back({{"price", level.price}, {"qty", level.quantity}});
             }
             j["bids"] = bids;
             j["asks"] = asks;
+            if (book.inAuction()) {
+                auto indicative = book.getIndicative();
+                j["auction"] = indicative ? json{{"price", indicative->price}, {"qty", indicative->volume}} : json::object();
+            }
             
             server.broadcast(j.dump());
         });
 
         std::cout << "Starting Matching Engine..." << std::endl;
+        if (journal) journal->start();
         engine.start();
 
+        std::atomic<bool> serving{true};
+        std::thread latencyReporter;
+        if (latencyEvery > 0) {
+            latencyReporter = std::thread([&] {
+                auto next = std::chrono::steady_clock::now();
+                while (serving) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    if (std::chrono::steady_clock::now() < next + std::chrono::seconds(latencyEvery)) continue;
+                    next = std::chrono::steady_clock::now();
+                    std::cout << "Latency (ns)\n" << latency.report() << std::flush;
+                }
+            });
+        }
+
         std::cout << "Starting WebSocket Server on port 8080..." << std::endl;
         server.run(); // Blocks
 
+        serving = false;
+        if (latencyReporter.joinable()) latencyReporter.join();
         engine.stop();
+        if (journal) journal->stop(); // After the engine: flushes its last commands
+        if (publisher) publisher->close(); // Last: the follower takes over from here
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
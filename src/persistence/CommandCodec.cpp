@@ -0,0 +1,224 @@
+#include "CommandCodec.hpp"
+#include <array>
+#include <cstring>
+
+namespace ome {
+
+namespace {
+
+template<typename T>
+void put(std::vector<char>& out, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Bounds-checked reader; any overrun leaves ok == false
+struct Reader {
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    template<typename T>
+    T get() {
+        T value{};
+        if (size - pos < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+};
+
+int64_t toNanos(Timestamp tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+Timestamp fromNanos(int64_t ns) {
+    return Timestamp(std::chrono::duration_cast<Timestamp::duration>(std::chrono::nanoseconds(ns)));
+}
+
+void encodeOrder(const Order& order, std::vector<char>& out) {
+    put<uint64_t>(out, order.id);
+    put<uint8_t>(out, static_cast<uint8_t>(order.side));
+    put<uint64_t>(out, order.price);
+    put<uint8_t>(out, static_cast<uint8_t>(order.type));
+    put<uint64_t>(out, order.stopPrice);
+    put<uint64_t>(out, order.account);
+    put<uint64_t>(out, order.session);
+    put<uint8_t>(out, static_cast<uint8_t>(order.stpMode));
+    put<uint8_t>(out, static_cast<uint8_t>(order.timeInForce));
+    put<int64_t>(out, toNanos(order.expireAt));
+    put<uint64_t>(out, order.initialQuantity);
+    put<uint64_t>(out, order.displayQuantity);
+}
+
+Order decodeOrder(Reader& in) {
+    OrderId id = in.get<uint64_t>();
+    Side side = static_cast<Side>(in.get<uint8_t>());
+    Price price = in.get<uint64_t>();
+    OrderType type = static_cast<OrderType>(in.get<uint8_t>());
+    Price stopPrice = in.get<uint64_t>();
+    AccountId account = in.get<uint64_t>();
+    SessionId session = in.get<uint64_t>();
+    StpMode stpMode = static_cast<StpMode>(in.get<uint8_t>());
+    TimeInForce timeInForce = static_cast<TimeInForce>(in.get<uint8_t>());
+    int64_t expireAt = in.get<int64_t>();
+    Quantity quantity = in.get<uint64_t>();
+
+    Order order(id, side, price, quantity);
+    order.type = type;
+    order.stopPrice = stopPrice;
+    order.account = account;
+    order.session = session;
+    order.stpMode = stpMode;
+    order.timeInForce = timeInForce;
+    order.expireAt = fromNanos(expireAt);
+    order.displayQuantity = in.get<uint64_t>();
+    return order;
+}
+
+} // namespace
+
+uint32_t CommandCodec::crc32(const char* data, size_t size) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void CommandCodec::encode(uint64_t sequence, Timestamp timestamp, const Command& cmd, std::vector<char>& out) {
+    const size_t start = out.size();
+    out.resize(start + kHeaderSize); // Length and checksum filled in below
+
+    put<uint64_t>(out, sequence);
+    put<int64_t>(out, toNanos(timestamp));
+    put<uint8_t>(out, static_cast<uint8_t>(cmd.type));
+
+    switch (cmd.type) {
+    case Command::Add:
+        encodeOrder(*cmd.order, out);
+        break;
+    case Command::Cancel:
+        put<uint64_t>(out, *cmd.orderId);
+        put<uint64_t>(out, cmd.session);
+        break;
+    case Command::Modify:
+        put<uint64_t>(out, *cmd.orderId);
+        put<uint64_t>(out, cmd.price);
+        put<uint64_t>(out, cmd.quantity);
+        put<uint64_t>(out, cmd.session);
+        break;
+    case Command::BulkCancel:
+    case Command::Expire:
+        put<uint64_t>(out, cmd.orderIds.size());
+        for (OrderId id : cmd.orderIds) {
+            put<uint64_t>(out, id);
+        }
+        break;
+    case Command::MassCancel:
+        put<uint64_t>(out, cmd.massCancel.account);
+        put<uint8_t>(out, cmd.massCancel.side ? 1 + static_cast<uint8_t>(*cmd.massCancel.side) : 0);
+        put<uint64_t>(out, cmd.massCancel.minPrice);
+        put<uint64_t>(out, cmd.massCancel.maxPrice);
+        break;
+    case Command::StartAuction:
+    case Command::Uncross:
+    case Command::Stop:
+        break;
+    }
+
+    const uint32_t length = static_cast<uint32_t>(out.size() - start - kHeaderSize);
+    const uint32_t crc = crc32(out.data() + start + kHeaderSize, length);
+    std::memcpy(out.data() + start, &length, sizeof(length));
+    std::memcpy(out.data() + start + sizeof(length), &crc, sizeof(crc));
+}
+
+size_t CommandCodec::peek(const char* data, size_t size, uint64_t& sequence) {
+    if (size < kHeaderSize + sizeof(uint64_t)) return 0;
+
+    uint32_t length;
+    std::memcpy(&length, data, sizeof(length));
+    if (length < sizeof(uint64_t) || length > kMaxBodySize || size - kHeaderSize < length) return 0;
+    std::memcpy(&sequence, data + kHeaderSize, sizeof(sequence));
+    return kHeaderSize + length;
+}
+
+size_t CommandCodec::decode(const char* data, size_t size, JournalRecord& record) {
+    if (size < kHeaderSize) return 0;
+
+    uint32_t length;
+    uint32_t crc;
+    std::memcpy(&length, data, sizeof(length));
+    std::memcpy(&crc, data + sizeof(length), sizeof(crc));
+    if (length == 0 || length > kMaxBodySize || size - kHeaderSize < length) return 0;
+
+    const char* body = data + kHeaderSize;
+    if (crc32(body, length) != crc) return 0;
+
+    Reader in{body, length};
+    record.sequence = in.get<uint64_t>();
+    record.timestamp = fromNanos(in.get<int64_t>());
+    auto type = static_cast<Command::Type>(in.get<uint8_t>());
+
+    Command cmd{type, std::nullopt, std::nullopt};
+    switch (type) {
+    case Command::Add:
+        cmd.order = decodeOrder(in);
+        break;
+    case Command::Cancel:
+        cmd.orderId = in.get<uint64_t>();
+        cmd.session = in.get<uint64_t>();
+        break;
+    case Command::Modify:
+        cmd.orderId = in.get<uint64_t>();
+        cmd.price = in.get<uint64_t>();
+        cmd.quantity = in.get<uint64_t>();
+        cmd.session = in.get<uint64_t>();
+        break;
+    case Command::BulkCancel:
+    case Command::Expire: {
+        uint64_t count = in.get<uint64_t>();
+        if (count > length / sizeof(OrderId)) return 0;
+        cmd.orderIds.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            cmd.orderIds.push_back(in.get<uint64_t>());
+        }
+        break;
+    }
+    case Command::MassCancel: {
+        cmd.massCancel.account = in.get<uint64_t>();
+        uint8_t side = in.get<uint8_t>();
+        if (side) cmd.massCancel.side = static_cast<Side>(side - 1);
+        cmd.massCancel.minPrice = in.get<uint64_t>();
+        cmd.massCancel.maxPrice = in.get<uint64_t>();
+        break;
+    }
+    case Command::StartAuction:
+    case Command::Uncross:
+        break;
+    default:
+        return 0;
+    }
+
+    if (!in.ok || in.pos != length) return 0;
+    record.command = std::move(cmd);
+    return kHeaderSize + length;
+}
+
+} // namespace ome
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "engine/Command.hpp"
+#include "common/Clock.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ome {
+
+// A sequenced command as stored in the journal
+struct JournalRecord {
+    uint64_t sequence;
+    Timestamp timestamp;
+    Command command;
+};
+
+// Binary framing for journal records, in host byte order:
+//
+//   u32 bodyLength | u32 crc32(body) | body
+//   body = u64 sequence | i64 timestamp (ns) | u8 type | type-specific fields
+//
+// A zero length marks the end of the log (preallocated space is zero-filled),
+// and a length or checksum that does not fit marks a torn tail.
+struct CommandCodec {
+    static constexpr size_t kHeaderSize = 8;
+    static constexpr uint32_t kMaxBodySize = 64u << 20;
+
+    // Appends one framed record to `out`
+    static void encode(uint64_t sequence, Timestamp timestamp, const Command& cmd, std::vector<char>& out);
+
+    // Decodes the record at the start of `data`. Returns the bytes consumed,
+    // or 0 if there is no complete, intact record there.
+    static size_t decode(const char* data, size_t size, JournalRecord& record);
+
+    // Framing only, no checksum or decode: the record's size and sequence
+    // number, or 0 if no complete record fits
+    static size_t peek(const char* data, size_t size, uint64_t& sequence);
+
+    static uint32_t crc32(const char* data, size_t size);
+};
+
+} // namespace ome
@@ -0,0 +1,176 @@
+#include "Journal.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ome {
+
+Journal::Journal(const std::string& path, Durability durability, size_t preallocateBytes)
+    : path(path), mode(durability), preallocateBytes(preallocateBytes) {
+    replay(path, [this](JournalRecord& record) { recoveredSequence = record.sequence; }, &offset);
+    durable = recoveredSequence;
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("journal: cannot open " + path + ": " + std::strerror(errno));
+    }
+
+    // Drop a torn tail and any old preallocation so everything past the
+    // last record reads back as zeros
+    if (::ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("journal: cannot truncate " + path + ": " + std::strerror(errno));
+    }
+    allocated = offset;
+    if (!reserve(1)) {
+        ::close(fd);
+        throw std::runtime_error("journal: cannot preallocate " + path);
+    }
+    ::fsync(fd);
+}
+
+Journal::~Journal() {
+    stop();
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void Journal::start() {
+    thread = std::thread(&Journal::run, this);
+}
+
+void Journal::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Journal::append(uint64_t sequence, Timestamp timestamp, const Command& cmd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CommandCodec::encode(sequence, timestamp, cmd, pending);
+        pendingSequence = sequence;
+    }
+    cv.notify_one();
+}
+
+void Journal::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return !pending.empty() || stopping; });
+        if (pending.empty()) break; // Stopping with nothing left
+
+        // Everything appended since the last write goes out as one group
+        std::swap(pending, writing);
+        const uint64_t sequence = pendingSequence;
+        lock.unlock();
+
+        if (writeGroup(writing)) {
+            durable.store(sequence, std::memory_order_release);
+            if (onDurable) onDurable(sequence);
+        }
+        writing.clear();
+
+        lock.lock();
+    }
+}
+
+bool Journal::reserve(uint64_t bytes) {
+    if (offset + bytes <= allocated) return true;
+
+    uint64_t target = std::max(offset + bytes, allocated + preallocateBytes);
+    int rc = ::posix_fallocate(fd, static_cast<off_t>(allocated), static_cast<off_t>(target - allocated));
+    if (rc != 0) {
+        std::cerr << "Journal preallocation failed: " << std::strerror(rc) << std::endl;
+        return false;
+    }
+    allocated = target;
+    return true;
+}
+
+bool Journal::writeGroup(const std::vector<char>& group) {
+    // After a failed write the log has a gap; nothing later may count as
+    // durable, so acks held for durability stay held
+    if (failed) return false;
+
+    if (!reserve(group.size())) {
+        failed = true;
+        return false;
+    }
+
+    size_t done = 0;
+    while (done < group.size()) {
+        ssize_t n = ::pwrite(fd, group.data() + done, group.size() - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Journal write failed: " << std::strerror(errno) << std::endl;
+            failed = true;
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    offset += group.size();
+
+    if (mode != Durability::Buffered && ::fdatasync(fd) != 0) {
+        std::cerr << "Journal sync failed: " << std::strerror(errno) << std::endl;
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+size_t Journal::replay(const std::string& path,
+                       const std::function<void(JournalRecord&)>& fn,
+                       uint64_t* validBytes,
+                       uint64_t afterSequence) {
+    if (validBytes) *validBytes = 0;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return 0; // No journal yet
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return 0;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("journal: cannot map " + path + ": " + std::strerror(errno));
+    }
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const char* data = static_cast<const char*>(mapped);
+    size_t pos = 0;
+    size_t count = 0;
+    JournalRecord record;
+    uint64_t sequence;
+    while (afterSequence > 0) {
+        size_t used = CommandCodec::peek(data + pos, size - pos, sequence);
+        if (used == 0 || sequence > afterSequence) break;
+        pos += used;
+    }
+    while (size_t used = CommandCodec::decode(data + pos, size - pos, record)) {
+        fn(record);
+        pos += used;
+        ++count;
+    }
+
+    ::munmap(mapped, size);
+    if (validBytes) *validBytes = pos;
+    return count;
+}
+
+} // namespace ome
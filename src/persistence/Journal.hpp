@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CommandCodec.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ome {
+
+enum class Durability {
+    Buffered,   // write() only: survives a process crash, not a power loss
+    Async,      // write() + fdatasync per group; acks do not wait for it
+    Sync        // As Async, and acks are held until their command is durable
+};
+
+// Append-only write-ahead log of sequenced engine commands.
+//
+// The engine thread only encodes into an in-memory group under a short lock;
+// a dedicated journaler thread swaps the group out, writes it with one pwrite
+// and syncs it (group commit), so everything appended while a sync is in
+// flight shares the next one. The file grows in preallocated, zero-filled
+// chunks so appends do not allocate blocks.
+class Journal {
+public:
+    using DurableCallback = std::function<void(uint64_t sequence)>;
+
+    // Opens or creates the journal and positions after its last intact
+    // record, discarding any torn tail. Throws std::runtime_error on failure.
+    Journal(const std::string& path, Durability durability, size_t preallocateBytes = 64u << 20);
+    ~Journal();
+
+    void start();
+    // Writes out everything appended so far, then joins the journaler
+    void stop();
+
+    // Engine thread; never touches the file
+    void append(uint64_t sequence, Timestamp timestamp, const Command& cmd);
+
+    // Journaler thread, after each group is written (and synced unless
+    // Buffered) with the last sequence number it contained; set before start()
+    void setDurableCallback(DurableCallback cb) { onDurable = std::move(cb); }
+
+    uint64_t durableSequence() const { return durable.load(std::memory_order_acquire); }
+    // Last sequence number found in the file when it was opened
+    uint64_t lastSequence() const { return recoveredSequence; }
+    Durability durability() const { return mode; }
+
+    // Calls fn for every intact record in order, stopping at the end of the
+    // log or at the first torn record. Returns the number of records and,
+    // through validBytes, the length of the intact prefix. Records up to
+    // afterSequence (e.g. covered by a snapshot) are skipped by their framing
+    // alone, without being checked or decoded.
+    static size_t replay(const std::string& path,
+                         const std::function<void(JournalRecord&)>& fn,
+                         uint64_t* validBytes = nullptr,
+                         uint64_t afterSequence = 0);
+
+private:
+    void run();
+    bool writeGroup(const std::vector<char>& group);
+    bool reserve(uint64_t bytes);
+
+    std::string path;
+    Durability mode;
+    uint64_t preallocateBytes;
+    int fd = -1;
+
+    // Journaler thread only (after the constructor)
+    uint64_t offset = 0;
+    uint64_t allocated = 0;
+    bool failed = false;
+    std::vector<char> writing;
+
+    uint64_t recoveredSequence = 0;
+
+    std::vector<char> pending;   // Next group, guarded by mutex
+    uint64_t pendingSequence = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::atomic<uint64_t> durable{0};
+    DurableCallback onDurable;
+    std::thread thread;
+};
+
+} // namespace ome
@@ -0,0 +1,169 @@
+#include "Snapshot.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <type_traits>
+
+namespace ome {
+
+namespace {
+
+int64_t toNanos(Timestamp tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+Timestamp fromNanos(int64_t ns) {
+    return Timestamp(std::chrono::duration_cast<Timestamp::duration>(std::chrono::nanoseconds(ns)));
+}
+
+// Buffered sequential writer over a raw descriptor
+class FileWriter {
+public:
+    explicit FileWriter(int fd) : fd(fd) {}
+
+    bool put(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            size_t n = std::min(size, sizeof(buffer) - used);
+            std::memcpy(buffer + used, bytes, n);
+            used += n;
+            bytes += n;
+            size -= n;
+            if (used == sizeof(buffer) && !flush()) return false;
+        }
+        return true;
+    }
+
+    bool flush() {
+        size_t done = 0;
+        while (done < used) {
+            ssize_t n = ::write(fd, buffer + done, used - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        used = 0;
+        return true;
+    }
+
+private:
+    int fd;
+    size_t used = 0;
+    char buffer[1 << 16];
+};
+
+} // namespace
+
+bool Snapshot::write(const std::string& path, const std::string& tmp,
+                     const OrderBook& book, uint64_t sequence) {
+    static_assert(sizeof(SnapshotOrder) == 88 && std::is_trivially_copyable_v<SnapshotOrder>);
+
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    if (auto last = book.getLastTradePrice()) {
+        header.flags |= kHasLastTrade;
+        header.lastTradePrice = *last;
+    }
+    if (book.inAuction()) header.flags |= kAuction;
+    header.sequence = sequence;
+    header.orderCount = book.orderCount();
+
+    FileWriter writer(fd);
+    bool ok = writer.put(&header, sizeof(header));
+    book.visitOrders([&](const Order& order) {
+        if (!ok) return;
+        SnapshotOrder record{};
+        record.id = order.id;
+        record.price = order.price;
+        record.stopPrice = order.stopPrice;
+        record.account = order.account;
+        record.expireAt = toNanos(order.expireAt);
+        record.timestamp = toNanos(order.timestamp);
+        record.initialQuantity = order.initialQuantity;
+        record.remainingQuantity = order.remainingQuantity;
+        record.displayQuantity = order.displayQuantity;
+        record.hiddenQuantity = order.hiddenQuantity;
+        record.side = static_cast<uint8_t>(order.side);
+        record.type = static_cast<uint8_t>(order.type);
+        record.stpMode = static_cast<uint8_t>(order.stpMode);
+        record.timeInForce = static_cast<uint8_t>(order.timeInForce);
+        ok = writer.put(&record, sizeof(record));
+    });
+    ok = ok && writer.put(kTrailer, sizeof(kTrailer)) && writer.flush();
+    ok = ok && ::fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::optional<uint64_t> Snapshot::load(const std::string& path, OrderBook& book) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return std::nullopt;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header) + sizeof(kTrailer)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return std::nullopt;
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const char* data = static_cast<const char*>(mapped);
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    const bool valid =
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+        header.version == kVersion &&
+        header.orderCount == (size - sizeof(Header) - sizeof(kTrailer)) / sizeof(SnapshotOrder) &&
+        size == sizeof(Header) + header.orderCount * sizeof(SnapshotOrder) + sizeof(kTrailer) &&
+        std::memcmp(data + size - sizeof(kTrailer), kTrailer, sizeof(kTrailer)) == 0;
+    if (!valid) {
+        ::munmap(mapped, size);
+        return std::nullopt;
+    }
+
+    book.reserve(header.orderCount);
+    const char* records = data + sizeof(Header);
+    for (uint64_t i = 0; i < header.orderCount; ++i) {
+        SnapshotOrder record;
+        std::memcpy(&record, records + i * sizeof(SnapshotOrder), sizeof(record));
+
+        Order order(record.id, static_cast<Side>(record.side), record.price, record.initialQuantity);
+        order.type = static_cast<OrderType>(record.type);
+        order.stopPrice = record.stopPrice;
+        order.account = record.account;
+        order.stpMode = static_cast<StpMode>(record.stpMode);
+        order.timeInForce = static_cast<TimeInForce>(record.timeInForce);
+        order.expireAt = fromNanos(record.expireAt);
+        order.timestamp = fromNanos(record.timestamp);
+        order.remainingQuantity = record.remainingQuantity;
+        order.displayQuantity = record.displayQuantity;
+        order.hiddenQuantity = record.hiddenQuantity;
+        book.restoreOrder(order);
+    }
+
+    std::optional<Price> lastTrade;
+    if (header.flags & kHasLastTrade) lastTrade = header.lastTradePrice;
+    book.restoreState(lastTrade, (header.flags & kAuction) != 0);
+
+    ::munmap(mapped, size);
+    return header.sequence;
+}
+
+} // namespace ome
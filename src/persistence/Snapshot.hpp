@@ -0,0 +1,68 @@
+#pragma once
+
+#include "engine/OrderBook.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace ome {
+
+// Binary image of a book at a journal sequence number, in host byte order:
+//
+//   Header | SnapshotOrder x orderCount | trailer magic
+//
+// Orders are stored as fixed-size records in visitOrders() order (levels in
+// priority order, FIFO within a level, then pending stops), which is exactly
+// the order restoreOrder() needs, so loading is one sequential pass over an
+// mmap of the file.
+class Snapshot {
+public:
+    // Writes tmp, syncs it and renames it over path, so the latest complete
+    // snapshot is always the one at path. Runs in a forked child, so it uses
+    // only a fixed buffer and plain syscalls; both paths are built by the
+    // parent beforehand (tmp is tmpPath(path)).
+    static bool write(const std::string& path, const std::string& tmp,
+                      const OrderBook& book, uint64_t sequence);
+    static std::string tmpPath(const std::string& path) { return path + ".tmp"; }
+
+    // Bulk-loads a snapshot into an empty book. Orders come back without a
+    // session, since no connection survives a restart. Returns the sequence
+    // number it was taken at, or nullopt if there is no valid snapshot.
+    static std::optional<uint64_t> load(const std::string& path, OrderBook& book);
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t sequence;
+        uint64_t lastTradePrice;
+        uint64_t orderCount;
+    };
+
+    struct SnapshotOrder {
+        uint64_t id;
+        uint64_t price;
+        uint64_t stopPrice;
+        uint64_t account;
+        int64_t expireAt;       // ns since epoch
+        int64_t timestamp;      // ns since epoch
+        uint64_t initialQuantity;
+        uint64_t remainingQuantity;
+        uint64_t displayQuantity;
+        uint64_t hiddenQuantity;
+        uint8_t side;
+        uint8_t type;
+        uint8_t stpMode;
+        uint8_t timeInForce;
+        uint8_t reserved[4];
+    };
+
+    static constexpr char kMagic[8] = {'O', 'M', 'E', 'S', 'N', 'A', 'P', '1'};
+    static constexpr char kTrailer[8] = {'O', 'M', 'E', 'S', 'N', 'E', 'N', 'D'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kHasLastTrade = 1;
+    static constexpr uint32_t kAuction = 2;
+};
+
+} // namespace ome
@@ -0,0 +1,172 @@
+#include "CommandRing.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ome {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x474e4952454d4f31ull; // "1OMERING"
+constexpr size_t kEntryHeader = 8;
+
+size_t entryBytes(size_t payload) {
+    return (kEntryHeader + payload + 7) & ~size_t{7};
+}
+
+// A zombie counts as dead: it has exited, its parent just has not reaped it
+bool alive(pid_t pid) {
+    if (pid <= 0 || (::kill(pid, 0) != 0 && errno == ESRCH)) return false;
+
+    char path[32];
+    std::snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    std::FILE* stat = std::fopen(path, "r");
+    if (!stat) return true;
+    char state = 0;
+    int matched = std::fscanf(stat, "%*d (%*[^)]) %c", &state);
+    std::fclose(stat);
+    return matched != 1 || (state != 'Z' && state != 'X');
+}
+
+} // namespace
+
+CommandRing::CommandRing(const std::string& name, size_t capacity)
+    : name(name), owner(true) {
+    size_t ringBytes = 4096;
+    while (ringBytes < capacity) ringBytes <<= 1;
+
+    ::shm_unlink(name.c_str()); // A stale segment from an earlier primary
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("ring: cannot create " + name + ": " + std::strerror(errno));
+    }
+    if (::ftruncate(fd, static_cast<off_t>(sizeof(Header) + ringBytes)) != 0) {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::runtime_error("ring: cannot size " + name + ": " + std::strerror(errno));
+    }
+    map(fd, sizeof(Header) + ringBytes);
+
+    header = new (header) Header();
+    header->capacity = ringBytes;
+    header->primaryPid = ::getpid();
+    header->magic.store(kMagic, std::memory_order_release);
+    mask = ringBytes - 1;
+}
+
+CommandRing::CommandRing(const std::string& name)
+    : name(name), owner(false) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error("ring: cannot open " + name + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) <= sizeof(Header)) {
+        ::close(fd);
+        throw std::runtime_error("ring: " + name + " is not a command ring");
+    }
+    map(fd, static_cast<size_t>(st.st_size));
+
+    if (header->magic.load(std::memory_order_acquire) != kMagic ||
+        sizeof(Header) + header->capacity != mappedBytes) {
+        ::munmap(header, mappedBytes);
+        throw std::runtime_error("ring: " + name + " is not a command ring");
+    }
+    mask = header->capacity - 1;
+    cachedHead = header->tail.load(std::memory_order_acquire);
+}
+
+CommandRing::~CommandRing() {
+    ::munmap(header, mappedBytes);
+    if (owner) {
+        ::shm_unlink(name.c_str()); // The follower keeps its mapping
+    }
+}
+
+void CommandRing::map(int fd, size_t bytes) {
+    void* mapped = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        if (owner) ::shm_unlink(name.c_str());
+        throw std::runtime_error("ring: cannot map " + name + ": " + std::strerror(errno));
+    }
+    header = static_cast<Header*>(mapped);
+    data = static_cast<char*>(mapped) + sizeof(Header);
+    mappedBytes = bytes;
+}
+
+void CommandRing::put(uint64_t pos, const void* src, size_t size) {
+    size_t offset = pos & mask;
+    size_t first = std::min(size, header->capacity - offset);
+    std::memcpy(data + offset, src, first);
+    std::memcpy(data, static_cast<const char*>(src) + first, size - first);
+}
+
+void CommandRing::get(uint64_t pos, void* dst, size_t size) const {
+    size_t offset = pos & mask;
+    size_t first = std::min(size, header->capacity - offset);
+    std::memcpy(dst, data + offset, first);
+    std::memcpy(static_cast<char*>(dst) + first, data, size - first);
+}
+
+bool CommandRing::write(Kind kind, const char* payload, size_t size) {
+    const size_t bytes = entryBytes(size);
+    if (bytes > header->capacity) return false;
+
+    const uint64_t head = header->head.load(std::memory_order_relaxed);
+    if (head + bytes - cachedTail > header->capacity) {
+        cachedTail = header->tail.load(std::memory_order_acquire);
+        if (head + bytes - cachedTail > header->capacity) return false;
+    }
+
+    uint32_t entry[2] = {static_cast<uint32_t>(size), static_cast<uint32_t>(kind)};
+    put(head, entry, sizeof(entry));
+    put(head + kEntryHeader, payload, size);
+    header->head.store(head + bytes, std::memory_order_release);
+    return true;
+}
+
+bool CommandRing::read(Kind& kind, std::vector<char>& payload) {
+    const uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    if (tail == cachedHead) {
+        cachedHead = header->head.load(std::memory_order_acquire);
+        if (tail == cachedHead) return false;
+    }
+
+    uint32_t entry[2];
+    get(tail, entry, sizeof(entry));
+    payload.resize(std::min<size_t>(entry[0], header->capacity));
+    get(tail + kEntryHeader, payload.data(), payload.size());
+    kind = static_cast<Kind>(entry[1]);
+    header->tail.store(tail + entryBytes(payload.size()), std::memory_order_release);
+    return true;
+}
+
+bool CommandRing::primaryAlive() const {
+    return alive(header->primaryPid);
+}
+
+bool CommandRing::claimFollower() {
+    const pid_t self = ::getpid();
+    pid_t holder = header->followerPid.load(std::memory_order_acquire);
+    while (holder != self) {
+        if (holder != 0 && alive(holder)) return false;
+        if (header->followerPid.compare_exchange_weak(holder, self, std::memory_order_acq_rel)) break;
+    }
+    return true;
+}
+
+void CommandRing::releaseFollower() {
+    pid_t self = ::getpid();
+    header->followerPid.compare_exchange_strong(self, 0, std::memory_order_acq_rel);
+}
+
+} // namespace ome
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace ome {
+
+// Single-producer single-consumer byte ring in POSIX shared memory, carrying
+// the primary's sequenced command stream to one follower process.
+//
+// Entries are `u32 size | u32 kind | payload`, padded to 8 bytes so an entry
+// header never straddles the wrap; payloads may. Each side owns its cursor's
+// cache line and re-reads the other's only when its cached copy says the
+// ring is full (producer) or empty (consumer).
+class CommandRing {
+public:
+    enum class Kind : uint32_t { Command = 1, Checkpoint = 2 };
+    enum class State : uint32_t {
+        Live,
+        Closed,     // The primary shut down after its last entry
+        Overrun     // The follower fell a full ring behind; the stream has a hole
+    };
+
+    // Primary: creates (replacing any stale) segment `name` with `capacity`
+    // bytes of ring, rounded up to a power of two, and unlinks it on
+    // destruction. Throws std::runtime_error on failure.
+    CommandRing(const std::string& name, size_t capacity);
+    // Follower: attaches to the segment the primary created. Throws if it
+    // does not exist or is not a ring.
+    explicit CommandRing(const std::string& name);
+    ~CommandRing();
+
+    CommandRing(const CommandRing&) = delete;
+    CommandRing& operator=(const CommandRing&) = delete;
+
+    // Producer. False (and nothing written) if the entry does not fit.
+    bool write(Kind kind, const char* data, size_t size);
+    // Consumer. False if the ring is empty.
+    bool read(Kind& kind, std::vector<char>& payload);
+
+    State state() const { return static_cast<State>(header->state.load(std::memory_order_acquire)); }
+    void setState(State s) { header->state.store(static_cast<uint32_t>(s), std::memory_order_release); }
+
+    // False once the creating process has exited (crashed or not)
+    bool primaryAlive() const;
+    // Claims the consumer side for this process; false if another live
+    // follower holds it
+    bool claimFollower();
+    void releaseFollower();
+
+    // Highest sequence the primary's journal had made durable when it last
+    // wrote, and whether it journals at all
+    void setDurable(uint64_t sequence) { header->durable.store(sequence, std::memory_order_release); }
+    uint64_t durable() const { return header->durable.load(std::memory_order_acquire); }
+    void setJournaled(bool journaled) { header->journaled.store(journaled, std::memory_order_release); }
+    bool journaled() const { return header->journaled.load(std::memory_order_acquire); }
+
+private:
+    struct alignas(64) Header {
+        std::atomic<uint64_t> magic;        // Stored last by the creator
+        uint64_t capacity;
+        pid_t primaryPid;
+        alignas(64) std::atomic<uint64_t> head{0};     // Bytes ever written
+        std::atomic<uint64_t> durable{0};
+        alignas(64) std::atomic<uint64_t> tail{0};     // Bytes ever consumed
+        alignas(64) std::atomic<uint32_t> state{0};
+        std::atomic<uint32_t> journaled{0};
+        std::atomic<pid_t> followerPid{0};
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring cursors must be address-free");
+
+    void map(int fd, size_t bytes);
+    void put(uint64_t pos, const void* src, size_t size);
+    void get(uint64_t pos, void* dst, size_t size) const;
+
+    std::string name;
+    bool owner;
+    Header* header = nullptr;
+    char* data = nullptr;
+    size_t mappedBytes = 0;
+    uint64_t mask = 0;
+    uint64_t cachedTail = 0;   // Producer's view of the consumer
+    uint64_t cachedHead = 0;   // Consumer's view of the producer
+};
+
+} // namespace ome
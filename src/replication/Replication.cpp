@@ -0,0 +1,163 @@
+#include "Replication.hpp"
+#include "persistence/Journal.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace ome {
+
+namespace {
+
+struct CheckpointEntry {
+    uint64_t sequence;
+    uint64_t stateHash;
+};
+
+} // namespace
+
+const char* toString(ReplicationFollower::Result result) {
+    switch (result) {
+    case ReplicationFollower::Result::Promoted: return "promoted";
+    case ReplicationFollower::Result::Diverged: return "diverged";
+    case ReplicationFollower::Result::Overrun:  return "overrun";
+    case ReplicationFollower::Result::Gap:      return "gap";
+    }
+    return "unknown";
+}
+
+ReplicationPublisher::ReplicationPublisher(const std::string& ringName, size_t ringBytes,
+                                           uint64_t checkpointInterval)
+    : ring(ringName, ringBytes), checkpointInterval(checkpointInterval) {}
+
+ReplicationPublisher::~ReplicationPublisher() {
+    close();
+}
+
+void ReplicationPublisher::setJournal(const Journal* j) {
+    journal = j;
+    ring.setJournaled(journal != nullptr);
+}
+
+void ReplicationPublisher::publish(uint64_t sequence, Timestamp timestamp, const Command& cmd) {
+    if (!live) return;
+
+    if (journal) {
+        ring.setDurable(journal->durableSequence());
+    }
+    buffer.clear();
+    CommandCodec::encode(sequence, timestamp, cmd, buffer);
+    if (!ring.write(CommandRing::Kind::Command, buffer.data(), buffer.size())) {
+        overrun();
+    }
+}
+
+void ReplicationPublisher::checkpoint(uint64_t sequence, uint64_t stateHash) {
+    CheckpointEntry entry{sequence, stateHash};
+    if (!ring.write(CommandRing::Kind::Checkpoint, reinterpret_cast<const char*>(&entry), sizeof(entry))) {
+        overrun();
+    }
+}
+
+void ReplicationPublisher::overrun() {
+    live = false;
+    ring.setState(CommandRing::State::Overrun);
+    std::cerr << "Replication ring full: follower dropped" << std::endl;
+}
+
+void ReplicationPublisher::close() {
+    if (!live) return;
+    live = false;
+    if (journal) {
+        ring.setDurable(journal->durableSequence());
+    }
+    ring.setState(CommandRing::State::Closed);
+}
+
+ReplicationFollower::ReplicationFollower(const std::string& ringName) : ring(ringName) {
+    if (!ring.claimFollower()) {
+        throw std::runtime_error("replication: another follower is attached to " + ringName);
+    }
+}
+
+ReplicationFollower::~ReplicationFollower() {
+    ring.releaseFollower();
+}
+
+ReplicationFollower::Result ReplicationFollower::follow(
+        uint64_t afterSequence,
+        const std::function<void(JournalRecord&)>& apply,
+        const std::function<uint64_t()>& stateHash,
+        const std::atomic<bool>& promote) {
+    using namespace std::chrono_literals;
+    constexpr int kSpins = 1000;        // Busy-poll this long before sleeping
+    constexpr int kSleepsPerCheck = 20; // ~1ms between liveness probes
+
+    sequence = afterSequence;
+    std::vector<char> payload;
+    JournalRecord record;
+    CommandRing::Kind kind;
+    int idle = 0;
+    bool primaryGone = false;
+
+    while (!promote.load(std::memory_order_relaxed)) {
+        // Read the state before the ring: the primary marks it only after
+        // its last entry, so an empty ring seen afterwards is really drained
+        const CommandRing::State state = ring.state();
+
+        if (ring.read(kind, payload)) {
+            idle = 0;
+            if (kind == CommandRing::Kind::Checkpoint) {
+                CheckpointEntry entry;
+                if (payload.size() != sizeof(entry)) continue;
+                std::memcpy(&entry, payload.data(), sizeof(entry));
+                // Checkpoints inside the recovered prefix cannot be checked
+                if (entry.sequence == sequence && entry.stateHash != stateHash()) {
+                    std::cerr << "Replica diverged at sequence " << sequence << std::endl;
+                    return Result::Diverged;
+                }
+                continue;
+            }
+
+            if (CommandCodec::decode(payload.data(), payload.size(), record) == 0) {
+                std::cerr << "Corrupt replication entry after sequence " << sequence << std::endl;
+                return Result::Diverged;
+            }
+            if (record.sequence <= sequence) continue; // Already recovered from the journal
+            if (record.sequence != sequence + 1) {
+                std::cerr << "Replication stream starts at " << record.sequence
+                          << ", replica is at " << sequence << std::endl;
+                return Result::Gap;
+            }
+
+            apply(record);
+            sequence = record.sequence;
+            if (ring.journaled()) {
+                const uint64_t durable = ring.durable();
+                while (!pending.empty() && pending.front().sequence <= durable) {
+                    pending.pop_front();
+                }
+                if (record.sequence > durable) {
+                    pending.push_back(record);
+                }
+            }
+            continue;
+        }
+
+        if (state == CommandRing::State::Overrun) return Result::Overrun;
+        if (state == CommandRing::State::Closed) return Result::Promoted;
+
+        // Everything a dead primary wrote is already visible, so the first
+        // empty read after noticing it means the stream is complete
+        if (primaryGone) return Result::Promoted;
+        if (++idle <= kSpins) continue;
+        std::this_thread::sleep_for(50us);
+        if ((idle - kSpins) % kSleepsPerCheck == 0) {
+            primaryGone = !ring.primaryAlive();
+        }
+    }
+    return Result::Promoted;
+}
+
+} // namespace ome
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CommandRing.hpp"
+#include "persistence/CommandCodec.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ome {
+
+class Journal;
+
+// Primary side of hot-standby replication. The engine hands it every
+// sequenced command right after journaling it; it encodes the command in
+// journal format into the shared-memory ring and, every checkpointInterval
+// commands, the book's state hash once the command has been applied.
+//
+// A follower that falls a full ring behind marks the ring overrun and the
+// primary stops publishing rather than wait for it.
+class ReplicationPublisher {
+public:
+    ReplicationPublisher(const std::string& ringName, size_t ringBytes = 64u << 20,
+                         uint64_t checkpointInterval = 100'000);
+    ~ReplicationPublisher();
+
+    // The journal's durable sequence travels with each command so a promoted
+    // follower knows which of its commands the log may be missing
+    void setJournal(const Journal* journal);
+
+    // Engine thread
+    void publish(uint64_t sequence, Timestamp timestamp, const Command& cmd);
+    bool checkpointDue(uint64_t sequence) const {
+        return live && checkpointInterval && sequence % checkpointInterval == 0;
+    }
+    void checkpoint(uint64_t sequence, uint64_t stateHash);
+
+    // After the engine has stopped: the follower promotes once it drains
+    void close();
+
+private:
+    void overrun();
+
+    CommandRing ring;
+    uint64_t checkpointInterval;
+    const Journal* journal = nullptr;
+    std::vector<char> buffer;
+    bool live = true;
+};
+
+// Follower side: applies the primary's stream to a warm local engine until
+// it is time to take over.
+class ReplicationFollower {
+public:
+    enum class Result {
+        Promoted,   // Primary exited or closed the ring, or promotion was requested
+        Diverged,   // A checkpoint hash did not match
+        Overrun,    // The primary dropped replication; the stream has a hole
+        Gap         // The ring starts after the state this follower recovered
+    };
+
+    // Attaches to the primary's ring. Throws std::runtime_error if it does
+    // not exist or another follower is consuming it.
+    explicit ReplicationFollower(const std::string& ringName);
+    ~ReplicationFollower();
+
+    // Passes every command after `afterSequence` to `apply` in order (each
+    // must be applied before the next is read) and compares `stateHash()`
+    // with the primary's at each checkpoint. Returns once the ring is
+    // drained and the primary is gone, or as soon as `promote` is set.
+    Result follow(uint64_t afterSequence,
+                  const std::function<void(JournalRecord&)>& apply,
+                  const std::function<uint64_t()>& stateHash,
+                  const std::atomic<bool>& promote);
+
+    uint64_t lastSequence() const { return sequence; }
+    // Applied commands the primary's journal had not yet made durable when
+    // they were sent; on promotion they are appended to the journal
+    const std::deque<JournalRecord>& undurable() const { return pending; }
+
+private:
+    CommandRing ring;
+    uint64_t sequence = 0;
+    std::deque<JournalRecord> pending;
+};
+
+const char* toString(ReplicationFollower::Result result);
+
+} // namespace ome
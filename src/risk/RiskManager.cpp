@@ -0,0 +1,153 @@
+#include "RiskManager.hpp"
+
+namespace ome {
+
+const char* toString(RiskResult result) {
+    switch (result) {
+    case RiskResult::Accepted:           return "accepted";
+    case RiskResult::InvalidQuantity:    return "invalid_quantity";
+    case RiskResult::OrderTooLarge:      return "order_too_large";
+    case RiskResult::NotionalTooLarge:   return "notional_too_large";
+    case RiskResult::TooManyOpenOrders:  return "too_many_open_orders";
+    case RiskResult::OutsidePriceCollar: return "outside_price_collar";
+    case RiskResult::NoReferencePrice:   return "no_reference_price";
+    case RiskResult::RateLimited:        return "rate_limited";
+    }
+    return "unknown";
+}
+
+RiskManager::RiskManager(RiskLimits defaults, size_t maxAccounts) {
+    size_t capacity = 1;
+    while (capacity < maxAccounts * 2) capacity <<= 1; // Keep the load factor under 1/2
+    mask = capacity - 1;
+    accounts = std::make_unique<AccountState[]>(capacity);
+
+    // Limits are written here and in setLimits() only, so claiming a slot
+    // later never races with a reader of its limits
+    for (size_t i = 0; i < capacity; ++i) {
+        accounts[i].limits = defaults;
+    }
+    unassigned.limits = defaults;
+}
+
+void RiskManager::setLimits(AccountId account, const RiskLimits& limits) {
+    AccountState* state = find(account);
+    if (state != &unassigned) {
+        state->limits = limits;
+    }
+}
+
+RiskManager::AccountState* RiskManager::find(AccountId account) {
+    if (account == kNoAccount) return &unassigned;
+
+    size_t slot = static_cast<size_t>(account * 0x9E3779B97F4A7C15ull) & mask;
+    for (size_t probe = 0; probe <= mask; ++probe, slot = (slot + 1) & mask) {
+        AccountState& state = accounts[slot];
+        AccountId owner = state.account.load(std::memory_order_acquire);
+        if (owner == account) return &state;
+        if (owner == kNoAccount) {
+            if (state.account.compare_exchange_strong(owner, account, std::memory_order_acq_rel)) {
+                return &state;
+            }
+            if (owner == account) return &state; // Another thread claimed it for us
+        }
+    }
+    return &unassigned;
+}
+
+RiskResult RiskManager::countMessage(AccountState& state) {
+    const uint32_t max = state.limits.maxMessagesPerSecond;
+    if (max == 0) return RiskResult::Accepted;
+
+    // Fixed one-second window. Whoever moves the window resets the count; a
+    // message racing the reset may land in either second.
+    uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    uint64_t window = state.window.load(std::memory_order_relaxed);
+    if (window != now && state.window.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        state.messages.store(0, std::memory_order_relaxed);
+    }
+    if (state.messages.fetch_add(1, std::memory_order_relaxed) >= max) {
+        return RiskResult::RateLimited;
+    }
+    return RiskResult::Accepted;
+}
+
+Price RiskManager::referencePrice() const {
+    Price last = lastTrade.load(std::memory_order_relaxed);
+    return last ? last : midPrice.load(std::memory_order_relaxed);
+}
+
+void RiskManager::onQuote(Price bestBid, Price bestAsk) {
+    Price mid = (bestBid && bestAsk) ? bestBid + (bestAsk - bestBid) / 2 : 0;
+    midPrice.store(mid, std::memory_order_relaxed);
+}
+
+RiskResult RiskManager::checkMessage(AccountId account) {
+    return countMessage(*find(account));
+}
+
+RiskResult RiskManager::checkPrice(const RiskLimits& limits, OrderType type,
+                                   Price price, Price stopPrice, Quantity qty) const {
+    if (qty == 0) return RiskResult::InvalidQuantity;
+    if (qty > limits.maxOrderQuantity) return RiskResult::OrderTooLarge;
+
+    // Market orders are valued at the reference, stop-market at the stop.
+    // Without a reference a market order's notional is unknown.
+    const Price reference = referencePrice();
+    Price notionalPrice = price;
+    if (type == OrderType::Market) {
+        if (!reference) return RiskResult::NoReferencePrice;
+        notionalPrice = reference;
+    } else if (type == OrderType::Stop) {
+        notionalPrice = stopPrice;
+    }
+    if (static_cast<unsigned __int128>(notionalPrice) * qty > limits.maxNotional) {
+        return RiskResult::NotionalTooLarge;
+    }
+
+    const bool hasLimitPrice = (type == OrderType::Limit || type == OrderType::StopLimit);
+    if (hasLimitPrice && reference && limits.priceCollarBps) {
+        Price distance = (price > reference) ? price - reference : reference - price;
+        if (static_cast<unsigned __int128>(distance) * 10'000 >
+            static_cast<unsigned __int128>(reference) * limits.priceCollarBps) {
+            return RiskResult::OutsidePriceCollar;
+        }
+    }
+    return RiskResult::Accepted;
+}
+
+RiskResult RiskManager::checkOrder(const Order& order) {
+    AccountState& state = *find(order.account);
+
+    RiskResult result = countMessage(state);
+    if (result == RiskResult::Accepted) {
+        result = checkPrice(state.limits, order.type, order.price, order.stopPrice, order.initialQuantity);
+    }
+    if (result != RiskResult::Accepted) return result;
+
+    // Reserve last so a rejection above never holds a slot
+    if (state.openOrders.fetch_add(1, std::memory_order_relaxed) >= static_cast<int64_t>(state.limits.maxOpenOrders)) {
+        state.openOrders.fetch_sub(1, std::memory_order_relaxed);
+        return RiskResult::TooManyOpenOrders;
+    }
+    return RiskResult::Accepted;
+}
+
+RiskResult RiskManager::checkModify(AccountId account, Price newPrice, Quantity newQuantity) {
+    AccountState& state = *find(account);
+
+    RiskResult result = countMessage(state);
+    if (result != RiskResult::Accepted || newQuantity == 0) return result; // 0 is a cancel
+    return checkPrice(state.limits, OrderType::Limit, newPrice, 0, newQuantity);
+}
+
+void RiskManager::restoreOpenOrder(AccountId account) {
+    find(account)->openOrders.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RiskManager::onOrderClosed(AccountId account) {
+    find(account)->openOrders.fetch_sub(1, std::memory_order_relaxed);
+}
+
+} // namespace ome
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "common/types.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace ome {
+
+struct RiskLimits {
+    Quantity maxOrderQuantity = 1'000'000;
+    uint64_t maxNotional = 1'000'000'000'000; // price * quantity
+    uint32_t maxOpenOrders = 10'000;
+    uint32_t priceCollarBps = 1'000;          // Distance from the reference price; 0 disables
+    uint32_t maxMessagesPerSecond = 1'000;    // 0 disables
+};
+
+enum class RiskResult {
+    Accepted,
+    InvalidQuantity,
+    OrderTooLarge,
+    NotionalTooLarge,
+    TooManyOpenOrders,
+    OutsidePriceCollar,
+    NoReferencePrice,
+    RateLimited
+};
+
+const char* toString(RiskResult result);
+
+// Pre-trade checks run on the ingress threads before an order is enqueued, so
+// the matcher never sees what they reject.
+//
+// Account state lives in a fixed open-addressing table whose slots are claimed
+// with a CAS on first use; after that every check is a handful of relaxed
+// atomic operations on the account's own cache line. Limits for specific
+// accounts are set before traffic starts; any other account gets the defaults.
+class RiskManager {
+public:
+    explicit RiskManager(RiskLimits defaults = {}, size_t maxAccounts = 4096);
+
+    // Not thread-safe against concurrent checks; configure before start
+    void setLimits(AccountId account, const RiskLimits& limits);
+
+    // New orders. Counts as one message and, if accepted, reserves an open
+    // order slot that onOrderClosed() gives back.
+    RiskResult checkOrder(const Order& order);
+    // Amendments face the same size, notional and collar checks as a new
+    // limit order; a quantity of 0 is a cancel
+    RiskResult checkModify(AccountId account, Price newPrice, Quantity newQuantity);
+    // Any other request from an account: rate only
+    RiskResult checkMessage(AccountId account);
+
+    // Engine thread: the order no longer rests or was never booked
+    void onOrderClosed(AccountId account);
+    // Journal recovery: an order accepted before the restart
+    void restoreOpenOrder(AccountId account);
+
+    // Engine thread: collar and market-order reference. The last trade price
+    // wins; the BBO midpoint is used until the first trade. Market orders are
+    // refused while there is neither.
+    void onTrade(Price price) { lastTrade.store(price, std::memory_order_relaxed); }
+    void onQuote(Price bestBid, Price bestAsk);
+
+private:
+    struct alignas(64) AccountState {
+        std::atomic<AccountId> account{kNoAccount};
+        std::atomic<int64_t> openOrders{0};
+        std::atomic<uint64_t> window{0};   // Second the message count belongs to
+        std::atomic<uint32_t> messages{0};
+        RiskLimits limits;
+    };
+
+    AccountState* find(AccountId account);
+    RiskResult countMessage(AccountState& state);
+    RiskResult checkPrice(const RiskLimits& limits, OrderType type,
+                          Price price, Price stopPrice, Quantity qty) const;
+    Price referencePrice() const;
+
+    size_t mask;
+    std::unique_ptr<AccountState[]> accounts;
+    AccountState unassigned; // Orders without an account, and table overflow
+
+    std::atomic<Price> lastTrade{0};
+    std::atomic<Price> midPrice{0};
+};
+
+} // namespace ome
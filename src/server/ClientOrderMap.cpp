@@ -0,0 +1,86 @@
+#include "ClientOrderMap.hpp"
+#include <functional>
+#include <utility>
+
+namespace ome {
+
+ClientOrderMap::ClientOrderMap(size_t initialCapacity) {
+    size_t capacity = 8;
+    while (capacity < initialCapacity) capacity <<= 1;
+    slots.resize(capacity);
+    mask = capacity - 1;
+}
+
+size_t ClientOrderMap::hashOf(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+size_t ClientOrderMap::probe(std::string_view key, size_t hash) const {
+    size_t i = hash & mask;
+    while (slots[i].used && (slots[i].hash != hash || slots[i].key != key)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+bool ClientOrderMap::insert(std::string_view clOrdId, OrderId orderId) {
+    // Grow at 3/4 full; an empty slot always ends every probe run
+    if ((count + 1) * 4 > slots.size() * 3) {
+        grow();
+    }
+
+    size_t hash = hashOf(clOrdId);
+    Slot& slot = slots[probe(clOrdId, hash)];
+    if (slot.used) return false;
+
+    slot.key.assign(clOrdId);
+    slot.hash = hash;
+    slot.orderId = orderId;
+    slot.used = true;
+    ++count;
+    return true;
+}
+
+std::optional<OrderId> ClientOrderMap::find(std::string_view clOrdId) const {
+    const Slot& slot = slots[probe(clOrdId, hashOf(clOrdId))];
+    if (!slot.used) return std::nullopt;
+    return slot.orderId;
+}
+
+bool ClientOrderMap::erase(std::string_view clOrdId) {
+    size_t hole = probe(clOrdId, hashOf(clOrdId));
+    if (!slots[hole].used) return false;
+
+    // Backward-shift deletion: pull later entries of the run into the hole
+    // unless their home slot lies cyclically after the hole
+    size_t i = hole;
+    while (true) {
+        i = (i + 1) & mask;
+        if (!slots[i].used) break;
+        size_t home = slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            std::swap(slots[hole], slots[i]);
+            hole = i;
+        }
+    }
+    slots[hole].used = false;
+    slots[hole].key.clear();
+    --count;
+    return true;
+}
+
+void ClientOrderMap::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.clear();
+    slots.resize(old.size() * 2);
+    mask = slots.size() - 1;
+
+    for (Slot& entry : old) {
+        if (!entry.used) continue;
+        size_t i = entry.hash & mask;
+        while (slots[i].used) i = (i + 1) & mask;
+        slots[i] = std::move(entry);
+    }
+}
+
+} // namespace ome
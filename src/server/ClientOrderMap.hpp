@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common/types.hpp"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ome {
+
+// Client order id -> engine OrderId for one connection. Open addressing with
+// linear probing in a flat slot array; lookups hash a string_view of the
+// incoming message, so resolving a cancel copies nothing. Erase shifts the
+// following run back instead of leaving tombstones, so a long-lived session
+// that churns orders keeps short probe sequences.
+class ClientOrderMap {
+public:
+    explicit ClientOrderMap(size_t initialCapacity = 16);
+
+    // False (and no change) if the key is already mapped
+    bool insert(std::string_view clOrdId, OrderId orderId);
+    std::optional<OrderId> find(std::string_view clOrdId) const;
+    bool erase(std::string_view clOrdId);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    struct Slot {
+        std::string key;
+        size_t hash = 0;
+        OrderId orderId = 0;
+        bool used = false;
+    };
+
+    static size_t hashOf(std::string_view key);
+    // Slot holding the key, or the empty slot that ends its probe run
+    size_t probe(std::string_view key, size_t hash) const;
+    void grow();
+
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t count = 0;
+};
+
+} // namespace ome
@@ -1,6 +1,9 @@
 #include "Server.hpp"
 #include <nlohmann/json.hpp>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <string_view>
 
 using json = nlohmann::json;
 
@@ -8,20 +11,25 @@ namespace ome {
 
 static std::atomic<OrderId> globalOrderId{1};
 
-Server::Server(uint16_t port, MatchingEngine& engine)
-    : port(port), engine(engine) {
+Server::Server(uint16_t port, MatchingEngine& engine, bool cancelOnDisconnect)
+    : port(port), engine(engine), defaultCancelOnDisconnect(cancelOnDisconnect) {
     
     server.init_asio();
     
     server.set_open_handler(bind(&Server::onOpen, this, std::placeholders::_1));
     server.set_close_handler(bind(&Server::onClose, this, std::placeholders::_1));
     server.set_message_handler(bind(&Server::onMessage, this, std::placeholders::_1, std::placeholders::_2));
+    server.set_http_handler(bind(&Server::onHttp, this, std::placeholders::_1));
     
     // Disable logging for performance/cleanliness
     server.clear_access_channels(websocketpp::log::alevel::all);
     server.set_error_channels(websocketpp::log::elevel::all);
 }
 
+void Server::setNextOrderId(OrderId next) {
+    globalOrderId = next;
+}
+
 void Server::run() {
     server.listen(port);
     server.start_accept();
@@ -36,6 +44,15 @@ void Server::onOpen(ConnectionHdl hdl) {
     {
         std::lock_guard<std::mutex> lock(connectionsMutex);
         connections.insert(hdl);
+        auto now = TokenBucket::Clock::now();
+        SessionId id = nextSessionId++;
+        Session& session = sessions[hdl] = Session{
+            id, hdl, defaultCancelOnDisconnect, {}, ClientOrderMap(), {},
+            TokenBucket(throttle.messageRate, throttle.messageBurst, now),
+            TokenBucket(throttle.orderRate, throttle.orderBurst, now),
+            TokenBucket(throttle.strikeRate, throttle.strikeBurst, now)
+        };
+        sessionsById[id] = &session;
     }
 
     // Send snapshot
@@ -52,52 +69,560 @@ void Server::onOpen(ConnectionHdl hdl) {
     }
     j["bids"] = bids;
     j["asks"] = asks;
+    if (book.inAuction()) {
+        auto indicative = book.getIndicative();
+        j["auction"] = indicative ? json{{"price", indicative->price}, {"qty", indicative->volume}} : json::object();
+    }
     
     try {
-        server.send(hdl, j.dump(), websocketpp::frame::opcode::text);
+        std::string snapshot = j.dump();
+        server.send(hdl, snapshot, websocketpp::frame::opcode::text);
+        countSent(1, snapshot.size());
     } catch (const websocketpp::exception& e) {
         std::cerr << "Send error: " << e.what() << std::endl;
     }
 }
 
 void Server::onClose(ConnectionHdl hdl) {
-    std::lock_guard<std::mutex> lock(connectionsMutex);
-    connections.erase(hdl);
+    std::vector<OrderId> orphaned;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections.erase(hdl);
+
+        auto it = sessions.find(hdl);
+        if (it != sessions.end()) {
+            if (it->second.cancelOnDisconnect) {
+                orphaned.reserve(it->second.orders.size());
+                for (const auto& entry : it->second.orders) {
+                    orphaned.push_back(entry.first);
+                }
+            }
+            sessionsById.erase(it->second.id);
+            sessions.erase(it);
+        }
+    }
+
+    // One engine command for the whole session, however many orders it had
+    if (!orphaned.empty()) {
+        engine.cancelOrders(std::move(orphaned));
+    }
+}
+
+// Value of a string field (key given with its quotes) without parsing the
+// document. Only used to pick a throttle and to label a throttle reject, so a
+// miss merely charges the message bucket alone or leaves the reject unlabeled.
+static std::string_view peekString(std::string_view payload, std::string_view key) {
+    size_t pos = payload.find(key);
+    if (pos == std::string_view::npos) return {};
+    pos = payload.find_first_not_of(" \t\r\n:", pos + key.size());
+    if (pos == std::string_view::npos || payload[pos] != '"') return {};
+    size_t end = payload.find('"', pos + 1);
+    if (end == std::string_view::npos) return {};
+    return payload.substr(pos + 1, end - pos - 1);
+}
+
+SessionId Server::admit(ConnectionHdl hdl, const std::string& payload) {
+    const bool isOrder = (peekString(payload, "\"type\"") == "add");
+    bool disconnect = false;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        auto it = sessions.find(hdl);
+        if (it == sessions.end()) return kNoSession;
+
+        Session& session = it->second;
+        auto now = TokenBucket::Clock::now();
+        bool admitted = session.messages.tryConsume(now);
+        if (!admitted) {
+            serverStats.messagesThrottled.fetch_add(1, std::memory_order_relaxed);
+        } else if (isOrder && !session.newOrders.tryConsume(now)) {
+            serverStats.ordersThrottled.fetch_add(1, std::memory_order_relaxed);
+            admitted = false;
+        }
+        if (admitted) return session.id;
+        disconnect = !session.strikes.tryConsume(now);
+    }
+
+    if (disconnect) {
+        serverStats.throttleDisconnects.fetch_add(1, std::memory_order_relaxed);
+        std::error_code ec;
+        server.close(hdl, websocketpp::close::status::policy_violation, "throttled", ec);
+    } else {
+        reject(hdl, "throttled", peekString(payload, "\"clOrdId\""));
+    }
+    return kNoSession;
 }
 
 void Server::onMessage(ConnectionHdl hdl, WSServer::message_ptr msg) {
+    // Picked up by the engine when the command is queued
+    LatencyStamps frame;
+    if (latency) frame.ingress = latencyTicks();
+    LatencyScope scope(latency ? &frame : nullptr);
+    if (metrics) {
+        metrics->add(Counter::MessagesReceived);
+        metrics->add(Counter::BytesReceived, msg->get_payload().size());
+    }
+
+    // Throttles run before parsing so a flood costs as little as possible
+    const SessionId sessionId = admit(hdl, msg->get_payload());
+    if (sessionId == kNoSession) {
+        return;
+    }
+
     try {
         auto j = json::parse(msg->get_payload());
         std::string type = j["type"];
+        std::string_view requestId;
+        if (auto it = j.find("clOrdId"); it != j.end() && it->is_string()) {
+            requestId = it->get_ref<const std::string&>();
+        }
 
         if (type == "add") {
             Side side = (j["side"] == "buy") ? Side::Buy : Side::Sell;
             Price price = j["price"];
             Quantity qty = j["qty"];
-            OrderId id = globalOrderId++;
-            
-            Order order(id, side, price, qty);
+
+            // Optional client order id, unique among the connection's open orders
+            std::string_view clOrdId;
+            if (j.contains("clOrdId")) {
+                clOrdId = j["clOrdId"].get_ref<const std::string&>();
+                if (!clOrdId.empty() && resolveClOrdId(hdl, clOrdId)) {
+                    reject(hdl, "duplicate_cl_ord_id", requestId);
+                    return;
+                }
+            }
+
+            Order order(0, side, price, qty);
+            order.displayQuantity = j.value("display", Quantity{0});
+            order.account = j.value("account", kNoAccount);
+
+            std::string tif = j.value("tif", std::string("gtc"));
+            if (tif == "day") {
+                if (!engine.hasSessionClose()) {
+                    reject(hdl, "no_session_close", requestId);
+                    return;
+                }
+                order.timeInForce = TimeInForce::Day;
+            } else if (tif == "gtt") {
+                order.timeInForce = TimeInForce::GTT;
+                order.expireAt = std::chrono::system_clock::time_point(
+                    std::chrono::milliseconds(j["expireAt"].get<int64_t>()));
+            }
+
+            std::string stp = j.value("stp", std::string("cancel_newest"));
+            if (stp == "cancel_oldest") {
+                order.stpMode = StpMode::CancelOldest;
+            } else if (stp == "cancel_both") {
+                order.stpMode = StpMode::CancelBoth;
+            } else if (stp == "decrement") {
+                order.stpMode = StpMode::Decrement;
+            }
+
+            std::string orderType = j.value("orderType", std::string("limit"));
+            if (orderType == "market") {
+                order.type = OrderType::Market;
+            } else if (orderType == "stop") {
+                order.type = OrderType::Stop;
+                order.stopPrice = j["stopPrice"];
+            } else if (orderType == "stop_limit") {
+                order.type = OrderType::StopLimit;
+                order.stopPrice = j["stopPrice"];
+            }
+
+            if (risk) {
+                RiskResult result = risk->checkOrder(order);
+                if (result != RiskResult::Accepted) {
+                    reject(hdl, toString(result), requestId);
+                    return;
+                }
+            }
+
+            order.id = globalOrderId++;
+            order.session = sessionId;
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                Session& session = sessions[hdl];
+                session.orders.emplace(order.id, OpenOrder{std::string(clOrdId), order.account});
+                if (order.account != kNoAccount) {
+                    session.accounts.insert(order.account);
+                }
+                if (!clOrdId.empty()) {
+                    session.clOrdIds.insert(clOrdId, order.id);
+                }
+            }
+            // The "new" execution report carries the assigned id back
             engine.addOrder(order);
         } else if (type == "cancel") {
-            OrderId id = j["orderId"];
-            engine.cancelOrder(id);
+            OrderId id;
+            if (j.contains("clOrdId")) {
+                // Resolved here; the engine only ever sees its own ids
+                auto resolved = resolveClOrdId(hdl, j["clOrdId"].get_ref<const std::string&>());
+                if (!resolved) {
+                    reject(hdl, "unknown_cl_ord_id", requestId);
+                    return;
+                }
+                id = *resolved;
+            } else {
+                id = j["orderId"];
+            }
+            // Only the connection's own orders; risk is charged to their account
+            auto account = ownedOrderAccount(hdl, id);
+            if (!account) {
+                reject(hdl, "unknown_order", requestId);
+                return;
+            }
+            if (risk) {
+                RiskResult result = risk->checkMessage(*account);
+                if (result != RiskResult::Accepted) {
+                    reject(hdl, toString(result), requestId);
+                    return;
+                }
+            }
+            engine.cancelOrder(id, sessionId);
+        } else if (type == "session") {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            auto& session = sessions[hdl];
+            session.cancelOnDisconnect = j.value("cancelOnDisconnect", session.cancelOnDisconnect);
+        } else if (type == "mass_cancel") {
+            // Only for an account this connection trades for
+            auto account = j.find("account");
+            if (account == j.end() || !account->is_number_unsigned() ||
+                account->get<AccountId>() == kNoAccount) {
+                reject(hdl, "invalid_account", requestId);
+                return;
+            }
+            MassCancelRequest request;
+            request.account = account->get<AccountId>();
+            if (!tradesFor(hdl, request.account)) {
+                reject(hdl, "unknown_account", requestId);
+                return;
+            }
+            if (j.contains("side")) {
+                request.side = (j["side"] == "buy") ? Side::Buy : Side::Sell;
+            }
+            request.minPrice = j.value("minPrice", request.minPrice);
+            request.maxPrice = j.value("maxPrice", request.maxPrice);
+            if (risk) {
+                RiskResult result = risk->checkMessage(request.account);
+                if (result != RiskResult::Accepted) {
+                    reject(hdl, toString(result), requestId);
+                    return;
+                }
+            }
+            engine.massCancel(request);
+        } else if (type == "modify") {
+            OrderId id;
+            if (j.contains("clOrdId")) {
+                auto resolved = resolveClOrdId(hdl, j["clOrdId"].get_ref<const std::string&>());
+                if (!resolved) {
+                    reject(hdl, "unknown_cl_ord_id", requestId);
+                    return;
+                }
+                id = *resolved;
+            } else {
+                id = j["orderId"];
+            }
+            auto account = ownedOrderAccount(hdl, id);
+            if (!account) {
+                reject(hdl, "unknown_order", requestId);
+                return;
+            }
+            Price price = j["price"];
+            Quantity qty = j["qty"];
+            if (risk) {
+                RiskResult result = risk->checkModify(*account, price, qty);
+                if (result != RiskResult::Accepted) {
+                    reject(hdl, toString(result), requestId);
+                    return;
+                }
+            }
+            engine.modifyOrder(id, price, qty, sessionId);
         }
     } catch (const std::exception& e) {
         std::cerr << "JSON error: " << e.what() << std::endl;
     }
 }
 
+void Server::reject(ConnectionHdl hdl, const char* reason, std::string_view clOrdId) {
+    if (metrics) metrics->add(Counter::Rejects);
+    json j;
+    j["type"] = "reject";
+    j["reason"] = reason;
+    if (!clOrdId.empty()) {
+        j["clOrdId"] = clOrdId;
+    }
+    try {
+        std::string message = j.dump();
+        server.send(hdl, message, websocketpp::frame::opcode::text);
+        countSent(1, message.size());
+    } catch (const websocketpp::exception& e) {
+        std::cerr << "Send error: " << e.what() << std::endl;
+    }
+}
+
+std::optional<OrderId> Server::resolveClOrdId(ConnectionHdl hdl, std::string_view clOrdId) {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    auto it = sessions.find(hdl);
+    if (it == sessions.end()) return std::nullopt;
+    return it->second.clOrdIds.find(clOrdId);
+}
+
+std::optional<AccountId> Server::ownedOrderAccount(ConnectionHdl hdl, OrderId id) {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    auto it = sessions.find(hdl);
+    if (it == sessions.end()) return std::nullopt;
+    auto orderIt = it->second.orders.find(id);
+    if (orderIt == it->second.orders.end()) return std::nullopt;
+    return orderIt->second.account;
+}
+
+bool Server::tradesFor(ConnectionHdl hdl, AccountId account) {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    auto it = sessions.find(hdl);
+    return it != sessions.end() && it->second.accounts.count(account) > 0;
+}
+
+static const char* execTypeName(ExecType type) {
+    switch (type) {
+    case ExecType::New:         return "new";
+    case ExecType::PartialFill: return "partial_fill";
+    case ExecType::Fill:        return "fill";
+    case ExecType::Canceled:    return "canceled";
+    case ExecType::Replaced:    return "replaced";
+    case ExecType::Rejected:    return "rejected";
+    case ExecType::Expired:     return "expired";
+    }
+    return "unknown";
+}
+
+void Server::sendExecutionReports(const std::vector<ExecutionReport>& reports) {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    for (const auto& report : reports) {
+        auto it = sessionsById.find(report.session);
+        if (it == sessionsById.end()) continue; // No session, or it has gone
+        Session& session = *it->second;
+
+        json j;
+        j["type"] = "exec";
+        j["exec"] = execTypeName(report.type);
+        j["orderId"] = report.orderId;
+
+        auto orderIt = session.orders.find(report.orderId);
+        if (orderIt != session.orders.end()) {
+            OpenOrder& open = orderIt->second;
+            if (!open.clOrdId.empty()) {
+                j["clOrdId"] = open.clOrdId;
+            }
+            // A rejected cancel or modify leaves the order live; only a reject
+            // of the order itself (before its "new") closes it
+            const bool closed = report.type == ExecType::Fill ||
+                                report.type == ExecType::Canceled ||
+                                report.type == ExecType::Expired ||
+                                (report.type == ExecType::Rejected && !open.acked);
+            if (report.type == ExecType::New) {
+                open.acked = true;
+            } else if (closed) {
+                if (!open.clOrdId.empty()) {
+                    session.clOrdIds.erase(open.clOrdId);
+                }
+                session.orders.erase(orderIt);
+            }
+        }
+        if (report.type != ExecType::Rejected) {
+            j["side"] = (report.side == Side::Buy) ? "buy" : "sell";
+            j["price"] = report.price;
+            j["leavesQty"] = report.leavesQuantity;
+            j["cumQty"] = report.cumQuantity;
+        }
+        if (report.type == ExecType::PartialFill || report.type == ExecType::Fill) {
+            j["lastPrice"] = report.lastPrice;
+            j["lastQty"] = report.lastQuantity;
+        }
+
+        try {
+            std::string message = j.dump();
+            server.send(session.hdl, message, websocketpp::frame::opcode::text);
+            countSent(1, message.size());
+        } catch (const websocketpp::exception& e) {
+            std::cerr << "Send error: " << e.what() << std::endl;
+        }
+    }
+    recordSent();
+}
+
+void Server::recordSent() {
+    const LatencyStamps* stamps = LatencyScope::current();
+    if (!latency || !stamps || !stamps->published) return;
+    const uint64_t sent = latencyTicks();
+    latency->record(LatencyStage::Send, stamps->published, sent);
+    latency->record(LatencyStage::Total, stamps->ingress, sent);
+}
+
 void Server::broadcast(const std::string& message) {
     std::lock_guard<std::mutex> lock(connectionsMutex);
+    size_t sent = 0;
     for (auto it = connections.begin(); it != connections.end(); ) {
         try {
             server.send(*it, message, websocketpp::frame::opcode::text);
+            ++sent;
             ++it;
         } catch (const websocketpp::exception& e) {
             std::cerr << "Broadcast error: " << e.what() << std::endl;
             it = connections.erase(it);
         }
     }
+    countSent(sent, sent * message.size());
+    recordSent();
+}
+
+void Server::countSent(size_t messages, size_t bytes) {
+    if (!metrics || messages == 0) return;
+    metrics->add(Counter::MessagesSent, messages);
+    metrics->add(Counter::BytesSent, bytes);
+}
+
+void Server::onHttp(ConnectionHdl hdl) {
+    WSServer::connection_ptr con = server.get_con_from_hdl(hdl);
+    if (!metrics || con->get_resource() != "/metrics") {
+        con->set_status(websocketpp::http::status_code::not_found);
+        con->set_body("not found\n");
+        return;
+    }
+    con->set_status(websocketpp::http::status_code::ok);
+    con->append_header("Content-Type", "text/plain; version=0.0.4");
+    con->set_body(renderMetrics());
+}
+
+namespace {
+
+// Prometheus text exposition format
+class MetricsText {
+public:
+    void header(const char* name, const char* type, const char* help) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+    void sample(const char* name, const std::string& labels, uint64_t value) {
+        write(name, labels, std::to_string(value));
+    }
+    void sample(const char* name, const std::string& labels, double value) {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.9g", value);
+        write(name, labels, number);
+    }
+    void single(const char* name, const char* type, const char* help, uint64_t value) {
+        header(name, type, help);
+        sample(name, {}, value);
+    }
+
+    std::string out;
+
+private:
+    void write(const char* name, const std::string& labels, const std::string& number) {
+        out += name;
+        if (!labels.empty()) {
+            out += '{';
+            out += labels;
+            out += '}';
+        }
+        out += ' ';
+        out += number;
+        out += '\n';
+    }
+};
+
+} // namespace
+
+std::string Server::renderMetrics() {
+    MetricsText text;
+
+    struct CounterInfo { Counter counter; const char* name; const char* help; };
+    static const CounterInfo counters[] = {
+        {Counter::MessagesReceived, "ome_messages_received_total", "WebSocket frames received, before throttling."},
+        {Counter::BytesReceived, "ome_bytes_received_total", "WebSocket payload bytes received."},
+        {Counter::Rejects, "ome_rejects_total", "Requests refused by the server (throttle, risk, unknown id)."},
+        {Counter::Commands, "ome_commands_total", "Commands sequenced by the engine."},
+        {Counter::Orders, "ome_orders_total", "Orders added."},
+        {Counter::Cancels, "ome_cancels_total", "Orders named by cancel requests."},
+        {Counter::Modifies, "ome_modifies_total", "Modify requests."},
+        {Counter::MassCancels, "ome_mass_cancels_total", "Mass cancel requests."},
+        {Counter::Trades, "ome_trades_total", "Fills, one per maker order."},
+        {Counter::TradedQuantity, "ome_traded_quantity_total", "Quantity filled."},
+        {Counter::Batches, "ome_engine_batches_total", "Engine wake-ups with commands to run."},
+        {Counter::MessagesSent, "ome_messages_sent_total", "WebSocket messages sent, per connection."},
+        {Counter::BytesSent, "ome_bytes_sent_total", "WebSocket payload bytes sent."},
+    };
+    for (const auto& c : counters) {
+        text.single(c.name, "counter", c.help, metrics->get(c.counter));
+    }
+    text.single("ome_messages_throttled_total", "counter", "Messages refused by the message throttle.",
+                serverStats.messagesThrottled.load(std::memory_order_relaxed));
+    text.single("ome_orders_throttled_total", "counter", "Orders refused by the order throttle.",
+                serverStats.ordersThrottled.load(std::memory_order_relaxed));
+    text.single("ome_throttle_disconnects_total", "counter", "Connections closed for running out of strikes.",
+                serverStats.throttleDisconnects.load(std::memory_order_relaxed));
+
+    size_t connectionCount;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connectionCount = connections.size();
+    }
+    text.single("ome_connections", "gauge", "Open WebSocket connections.", uint64_t{connectionCount});
+    text.single("ome_engine_queue_depth", "gauge", "Commands waiting for the engine thread.",
+                uint64_t{engine.queueDepth()});
+    text.single("ome_book_orders", "gauge", "Resting orders, stops included.",
+                metrics->get(Gauge::RestingOrders));
+    text.header("ome_book_levels", "gauge", "Price levels per side.");
+    text.sample("ome_book_levels", "side=\"bid\"", metrics->get(Gauge::BidLevels));
+    text.sample("ome_book_levels", "side=\"ask\"", metrics->get(Gauge::AskLevels));
+
+    static const std::pair<double, const char*> quantiles[] = {
+        {0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}, {0.9999, "0.9999"}
+    };
+    auto batches = std::make_unique<LatencyHistogram>();
+    metrics->batchSizes(*batches);
+    text.header("ome_engine_batch_commands", "summary", "Commands taken from the queue per engine wake-up.");
+    for (const auto& [q, label] : quantiles) {
+        text.sample("ome_engine_batch_commands", std::string("quantile=\"") + label + "\"",
+                    batches->quantile(q));
+    }
+    text.sample("ome_engine_batch_commands_sum", {}, batches->total());
+    text.sample("ome_engine_batch_commands_count", {}, batches->count());
+
+    if (latency) {
+        auto stages = latency->summary();
+        text.header("ome_latency_seconds", "summary", "Command latency per stage, frame in to bytes out.");
+        for (size_t s = 0; s < kLatencyStages; ++s) {
+            const LatencySummary& l = stages[s];
+            const std::string stage = std::string("stage=\"") + toString(static_cast<LatencyStage>(s)) + "\"";
+            const uint64_t values[] = {l.p50, l.p90, l.p99, l.p999, l.p9999};
+            for (size_t i = 0; i < std::size(values); ++i) {
+                text.sample("ome_latency_seconds", stage + ",quantile=\"" + quantiles[i].second + "\"",
+                            static_cast<double>(values[i]) * 1e-9);
+            }
+            text.sample("ome_latency_seconds_sum", stage, l.mean * static_cast<double>(l.count) * 1e-9);
+            text.sample("ome_latency_seconds_count", stage, l.count);
+        }
+    }
+
+    AllocatorStats alloc = allocatorStats();
+    if (alloc.available) {
+        text.single("ome_malloc_arena_bytes", "gauge", "Bytes malloc has obtained with sbrk and arena mmaps.",
+                    alloc.arenaBytes);
+        text.single("ome_malloc_in_use_bytes", "gauge", "Bytes allocated and not yet freed.",
+                    alloc.inUseBytes);
+        text.single("ome_malloc_free_bytes", "gauge", "Bytes held by malloc but not in use.",
+                    alloc.freeBytes);
+        text.single("ome_malloc_mmap_bytes", "gauge", "Bytes in blocks mapped directly.",
+                    alloc.mmapBytes);
+    }
+    return std::move(text.out);
 }
 
 } // namespace ome
@@ -1,36 +1,131 @@
 #pragma once
 
 #include "engine/MatchingEngine.hpp"
+#include "risk/RiskManager.hpp"
+#include "TokenBucket.hpp"
+#include "ClientOrderMap.hpp"
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
+#include <atomic>
+#include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <optional>
 
 namespace ome {
 
 using WSServer = websocketpp::server<websocketpp::config::asio>;
 using ConnectionHdl = websocketpp::connection_hdl;
 
+// Per-connection ingress limits (rates per second; a rate of 0 disables the
+// bucket). Every message spends a message token, adds also an order token.
+// Each throttled message spends a strike; a connection out of strikes is
+// disconnected.
+struct ThrottleConfig {
+    double messageRate = 1000;
+    double messageBurst = 2000;
+    double orderRate = 500;
+    double orderBurst = 1000;
+    double strikeRate = 10;
+    double strikeBurst = 100;
+};
+
+struct ServerStats {
+    std::atomic<uint64_t> messagesThrottled{0};
+    std::atomic<uint64_t> ordersThrottled{0};
+    std::atomic<uint64_t> throttleDisconnects{0};
+};
+
 class Server {
 public:
-    Server(uint16_t port, MatchingEngine& engine);
+    // cancelOnDisconnect is the default for new sessions; a client can
+    // override it with a "session" message
+    Server(uint16_t port, MatchingEngine& engine, bool cancelOnDisconnect = false);
     void run();
     void stop();
     void broadcast(const std::string& message);
 
+    // Optional pre-trade checks, run on the ingress thread; set before run()
+    void setRiskManager(RiskManager* manager) { risk = manager; }
+    // Applies to connections opened afterwards
+    void setThrottle(const ThrottleConfig& config) { throttle = config; }
+    // Stamps each frame on arrival and records the send and end-to-end
+    // stages of the engine's callbacks; set before run()
+    void setLatencyRecorder(LatencyRecorder* recorder) { latency = recorder; }
+    // Traffic counters, and the source of GET /metrics (Prometheus text
+    // format) on the same port; set before run()
+    void setMetrics(Metrics* sink) { metrics = sink; }
+
+    const ServerStats& stats() const { return serverStats; }
+
+    // Next engine OrderId to hand out (e.g. past those recovered from a journal)
+    static void setNextOrderId(OrderId next);
+
+    // Engine thread: delivers each report to the session that owns the order
+    void sendExecutionReports(const std::vector<ExecutionReport>& reports);
+
 private:
     void onOpen(ConnectionHdl hdl);
     void onClose(ConnectionHdl hdl);
     void onMessage(ConnectionHdl hdl, WSServer::message_ptr msg);
+    // Plain HTTP requests: /metrics
+    void onHttp(ConnectionHdl hdl);
+    std::string renderMetrics();
+    void countSent(size_t messages, size_t bytes);
+    // The connection's session id, or kNoSession if the message is refused
+    SessionId admit(ConnectionHdl hdl, const std::string& payload);
+    // Echoes the request's clOrdId, if it had one, so clients can match it
+    void reject(ConnectionHdl hdl, const char* reason, std::string_view clOrdId = {});
+    std::optional<OrderId> resolveClOrdId(ConnectionHdl hdl, std::string_view clOrdId);
+    // The account of the connection's open order `id`; nullopt if it has no such order
+    std::optional<AccountId> ownedOrderAccount(ConnectionHdl hdl, OrderId id);
+    // Whether the connection has placed orders for `account`
+    bool tradesFor(ConnectionHdl hdl, AccountId account);
+    // After a callback's sends: the stages of the command it was made for
+    void recordSent();
 
     WSServer server;
     uint16_t port;
     MatchingEngine& engine;
+    RiskManager* risk = nullptr;
+    LatencyRecorder* latency = nullptr;
+    Metrics* metrics = nullptr;
+
+    // Per-connection state: the orders it still has open, for
+    // cancel-on-disconnect, their client ids, the accounts it trades for,
+    // and its ingress throttles
+    struct OpenOrder {
+        std::string clOrdId; // Empty if none
+        AccountId account;
+        bool acked = false;  // "new" seen; a reject before it refuses the order itself
+    };
+    struct Session {
+        SessionId id;
+        ConnectionHdl hdl;
+        bool cancelOnDisconnect;
+        std::unordered_map<OrderId, OpenOrder> orders;
+        ClientOrderMap clOrdIds;
+        std::unordered_set<AccountId> accounts; // Of its adds; bounds mass_cancel
+        TokenBucket messages;
+        TokenBucket newOrders;
+        TokenBucket strikes;
+    };
+
+    bool defaultCancelOnDisconnect;
+    ThrottleConfig throttle;
+    ServerStats serverStats;
 
     std::set<ConnectionHdl, std::owner_less<ConnectionHdl>> connections;
-    std::mutex connectionsMutex;
+    std::map<ConnectionHdl, Session, std::owner_less<ConnectionHdl>> sessions;
+    // Report routing; points into `sessions` (map nodes are stable)
+    std::unordered_map<SessionId, Session*> sessionsById;
+    SessionId nextSessionId = 1;
+    std::mutex connectionsMutex; // Guards connections and all session state
 };
 
 } // namespace ome
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+namespace ome {
+
+// Classic token bucket: `rate` tokens per second, holding at most `burst`.
+// Not thread-safe; each connection owns its own.
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket() = default;
+    TokenBucket(double rate, double burst, Clock::time_point now = Clock::now())
+        : rate(rate), burst(burst), tokens(burst), last(now) {}
+
+    // Takes one token if available. A rate of 0 means unlimited.
+    bool tryConsume(Clock::time_point now) {
+        if (rate <= 0) return true;
+
+        std::chrono::duration<double> elapsed = now - last;
+        last = now;
+        tokens = std::min(burst, tokens + elapsed.count() * rate);
+        if (tokens < 1.0) return false;
+        tokens -= 1.0;
+        return true;
+    }
+
+private:
+    double rate = 0;
+    double burst = 0;
+    double tokens = 0;
+    Clock::time_point last{};
+};
+
+} // namespace ome
@@ -0,0 +1,354 @@
+// ome_bench: microbenchmarks for OrderBook and MatchingEngine at book sizes
+// from 100 to 1M resting orders. Results go to stdout (or --out) as JSON so
+// runs can be diffed between releases.
+//
+// Book operations are timed in batches and reported as ns/op; sweeps and the
+// engine round trip are timed one at a time and also report percentiles.
+// Work that only restores the book to its starting size is not timed.
+
+#include "engine/MatchingEngine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+using ome::Order;
+using ome::OrderBook;
+using ome::OrderId;
+using ome::Price;
+using ome::Quantity;
+using ome::Side;
+
+constexpr Price kMid = 1'000'000;
+constexpr Quantity kRestingQuantity = 100;
+constexpr size_t kOrdersPerLevel = 10;
+constexpr size_t kTimedOps = 100'000;  // Per batched benchmark
+constexpr size_t kSamples = 2'000;     // Per individually timed benchmark
+
+struct Result {
+    std::string name;
+    size_t bookSize;
+    size_t ops;
+    double nsPerOp;
+    std::vector<uint64_t> samples; // Per-op nanoseconds, if timed one at a time
+    size_t levels = 0;             // Sweeps: price levels taken out per op
+};
+
+// Keeps the compiler from discarding results
+volatile size_t sink = 0;
+
+uint64_t elapsedNs(SteadyClock::time_point since) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(SteadyClock::now() - since).count());
+}
+
+// Resting book of `orders` orders, half bids below kMid and half asks above,
+// kOrdersPerLevel orders per level
+struct BookFixture {
+    explicit BookFixture(size_t orders)
+        : levels(std::max<size_t>(1, orders / 2 / kOrdersPerLevel)), rng(42) {
+        book.reserve(orders * 2);
+        for (size_t i = 0; i < orders; ++i) {
+            book.addOrder(makeResting(i % 2 ? Side::Sell : Side::Buy));
+        }
+    }
+
+    Price levelPrice(Side side, size_t level) const {
+        return side == Side::Buy ? kMid - 1 - level : kMid + 1 + level;
+    }
+
+    Order makeResting(Side side, Quantity qty = kRestingQuantity) {
+        size_t level = (nextId / 2) % levels;
+        Order order(nextId++, side, levelPrice(side, level), qty);
+        live.push_back(order.id);
+        return order;
+    }
+
+    OrderBook book;
+    size_t levels;
+    OrderId nextId = 1;
+    std::vector<OrderId> live; // Ids added, including ones since cancelled
+    std::mt19937_64 rng;
+};
+
+Result batched(const std::string& name, size_t bookSize, size_t ops, uint64_t totalNs) {
+    return {name, bookSize, ops, static_cast<double>(totalNs) / static_cast<double>(ops), {}};
+}
+
+Result sampled(const std::string& name, size_t bookSize, std::vector<uint64_t> samples) {
+    uint64_t total = std::accumulate(samples.begin(), samples.end(), uint64_t{0});
+    Result result{name, bookSize, samples.size(),
+                  static_cast<double>(total) / static_cast<double>(samples.size()), std::move(samples)};
+    std::sort(result.samples.begin(), result.samples.end());
+    return result;
+}
+
+// New orders behind the touch, in batches that are then cancelled untimed
+Result benchAddResting(size_t size) {
+    BookFixture f(size);
+    const size_t batch = std::min<size_t>(std::max<size_t>(size, 100), 10'000);
+    std::vector<Order> orders;
+    uint64_t total = 0;
+    size_t done = 0;
+    while (done < kTimedOps) {
+        orders.clear();
+        for (size_t i = 0; i < batch; ++i) {
+            orders.push_back(f.makeResting(i % 2 ? Side::Sell : Side::Buy));
+        }
+        auto start = SteadyClock::now();
+        for (const auto& order : orders) {
+            sink = sink + f.book.addOrder(order).size();
+        }
+        total += elapsedNs(start);
+        done += batch;
+        for (const auto& order : orders) f.book.cancelOrder(order.id);
+    }
+    return batched("add_resting", size, done, total);
+}
+
+// One-lot aggressors that partially fill the order at the touch; the
+// resting side is sized so it never runs out
+Result benchAddCrossing(size_t size) {
+    BookFixture f(0);
+    for (size_t i = 0; i < std::max<size_t>(size, 2); ++i) {
+        f.book.addOrder(f.makeResting(i % 2 ? Side::Sell : Side::Buy, 1'000'000'000));
+    }
+    std::vector<Order> orders;
+    for (size_t i = 0; i < kTimedOps; ++i) {
+        Side side = i % 2 ? Side::Sell : Side::Buy;
+        orders.emplace_back(f.nextId++, side, side == Side::Buy ? kMid + 1 : kMid - 1, 1);
+    }
+    auto start = SteadyClock::now();
+    for (const auto& order : orders) {
+        sink = sink + f.book.addOrder(order).size();
+    }
+    return batched("add_crossing", size, orders.size(), elapsedNs(start));
+}
+
+// Random resting orders cancelled in batches, then re-added untimed
+Result benchCancel(size_t size) {
+    BookFixture f(size);
+    const size_t batch = std::min<size_t>(std::max<size_t>(size / 2, 50), 10'000);
+    std::vector<OrderId> ids(f.live);
+    uint64_t total = 0;
+    size_t done = 0;
+    while (done < kTimedOps) {
+        std::shuffle(ids.begin(), ids.end(), f.rng);
+        auto start = SteadyClock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            sink = sink + f.book.cancelOrder(ids[i]);
+        }
+        total += elapsedNs(start);
+        done += batch;
+        for (size_t i = 0; i < batch; ++i) {
+            Order order = f.makeResting(i % 2 ? Side::Sell : Side::Buy);
+            ids[i] = order.id;
+            f.book.addOrder(order);
+        }
+    }
+    return batched("cancel", size, done, total);
+}
+
+// Marketable limit orders that take out the top `depth` ask levels; the
+// liquidity is put back untimed after each sweep
+Result benchSweep(size_t size, size_t depth) {
+    BookFixture f(size);
+    depth = std::min(depth, f.levels);
+    const Price limit = f.levelPrice(Side::Sell, depth - 1);
+    std::vector<uint64_t> samples;
+    samples.reserve(kSamples);
+    for (size_t i = 0; i < kSamples; ++i) {
+        Quantity volume = 0;
+        std::vector<Price> swept;
+        for (const auto& level : f.book.getAsks()) {
+            if (level.price > limit) break;
+            volume += level.quantity;
+            swept.push_back(level.price);
+        }
+        Order taker(f.nextId++, Side::Buy, limit, volume);
+
+        auto start = SteadyClock::now();
+        sink = sink + f.book.addOrder(taker).size();
+        samples.push_back(elapsedNs(start));
+
+        for (Price price : swept) {
+            for (size_t n = 0; n < kOrdersPerLevel; ++n) {
+                f.book.addOrder(Order(f.nextId++, Side::Sell, price, kRestingQuantity));
+            }
+        }
+    }
+    Result result = sampled("sweep", size, std::move(samples));
+    result.levels = depth;
+    return result;
+}
+
+Result benchDepth(size_t size) {
+    BookFixture f(size);
+    const size_t calls = std::clamp<size_t>(100'000'000 / std::max<size_t>(size, 1), 10, 100'000);
+    auto start = SteadyClock::now();
+    for (size_t i = 0; i < calls; ++i) {
+        sink = sink + f.book.getBids().size() + f.book.getAsks().size();
+    }
+    return batched("get_bids_asks", size, calls, elapsedNs(start));
+}
+
+// addOrder() on the caller's thread to the execution report callback on the
+// engine thread, one order in flight at a time. Alternates a resting buy
+// with a sell that fills it, so the book stays at `size`.
+Result benchEngineRoundTrip(size_t size) {
+    ome::MatchingEngine engine;
+    std::atomic<OrderId> acked{0};
+    engine.setExecutionReportCallback([&acked](const std::vector<ome::ExecutionReport>& reports) {
+        // The last report may be the maker's fill; ids only grow
+        OrderId newest = 0;
+        for (const auto& report : reports) newest = std::max(newest, report.orderId);
+        acked.store(newest, std::memory_order_release);
+    });
+    engine.start();
+
+    // Preload through the engine, away from the prices used below
+    OrderId id = 1;
+    for (size_t i = 0; i < size; ++i, ++id) {
+        Side side = i % 2 ? Side::Sell : Side::Buy;
+        size_t level = (i / 2) % std::max<size_t>(1, size / 2 / kOrdersPerLevel);
+        engine.addOrder(Order(id, side, side == Side::Buy ? kMid - 10 - level : kMid + 10 + level,
+                              kRestingQuantity));
+    }
+    engine.addOrder(Order(id, Side::Buy, 1, 1));
+    while (acked.load(std::memory_order_acquire) != id) std::this_thread::yield();
+    ++id;
+
+    std::vector<uint64_t> samples;
+    samples.reserve(kSamples * 5);
+    for (size_t i = 0; i < kSamples * 5; ++i, ++id) {
+        Order order(id, i % 2 ? Side::Sell : Side::Buy, kMid, 1);
+        auto start = SteadyClock::now();
+        engine.addOrder(order);
+        while (acked.load(std::memory_order_acquire) != id) {}
+        samples.push_back(elapsedNs(start));
+    }
+    engine.stop();
+    return sampled("engine_round_trip", size, std::move(samples));
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+json toJson(const Result& result) {
+    json j = {
+        {"name", result.name},
+        {"book_size", result.bookSize},
+        {"ops", result.ops},
+        {"ns_per_op", result.nsPerOp}
+    };
+    if (result.levels) {
+        j["levels"] = result.levels;
+    }
+    if (!result.samples.empty()) {
+        j["p50_ns"] = percentile(result.samples, 50);
+        j["p99_ns"] = percentile(result.samples, 99);
+        j["max_ns"] = result.samples.back();
+    }
+    return j;
+}
+
+std::vector<size_t> parseSizes(const std::string& list) {
+    std::vector<size_t> sizes;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        sizes.push_back(std::stoull(item));
+    }
+    return sizes;
+}
+
+std::string isoTime() {
+    std::time_t now = std::time(nullptr);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buf;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {100, 1'000, 10'000, 100'000, 1'000'000};
+    std::string filter;
+    std::string outPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes = parseSizes(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--sizes N,N,...] [--filter NAME] [--out PATH]" << std::endl;
+            return 1;
+        }
+    }
+
+    struct Benchmark {
+        const char* name;
+        Result (*run)(size_t);
+    };
+    const Benchmark benchmarks[] = {
+        {"add_resting", benchAddResting},
+        {"add_crossing", benchAddCrossing},
+        {"cancel", benchCancel},
+        {"sweep", [](size_t size) { return benchSweep(size, 10); }},
+        {"get_bids_asks", benchDepth},
+        {"engine_round_trip", benchEngineRoundTrip},
+    };
+
+    json results = json::array();
+    for (const auto& benchmark : benchmarks) {
+        if (!filter.empty() && std::string(benchmark.name).find(filter) == std::string::npos) continue;
+        for (size_t size : sizes) {
+            Result result = benchmark.run(size);
+            std::cerr << result.name << " @" << size << ": " << result.nsPerOp << " ns/op" << std::endl;
+            results.push_back(toJson(result));
+        }
+    }
+
+    json report = {
+        {"timestamp", isoTime()},
+#ifdef NDEBUG
+        {"build", "release"},
+#else
+        {"build", "debug"},
+#endif
+        {"compiler", __VERSION__},
+        {"results", results}
+    };
+
+    if (outPath.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        std::ofstream out(outPath);
+        out << report.dump(2) << std::endl;
+        if (!out) {
+            std::cerr << "Cannot write " << outPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,800 @@
+// ome_fuzz: differential fuzzer for OrderBook. Every step of a command stream
+// decoded from the input bytes is applied to the production book and to
+// ReferenceBook, a deliberately naive model of the same rules: unsorted
+// vectors, linear scans, and an explicit sequence number for time priority.
+// After each step the trades, BBO, depth per level, every order in priority
+// order (including pending stops), the last trade price, auction state and
+// indicative uncross must agree. Independently of the comparison, the book
+// must never be crossed outside an auction, no trade may have the same
+// account on both sides, and the incrementally kept state hash must equal a
+// fresh one. The first failure aborts with the step that caused it.
+//
+// With OME_LIBFUZZER defined (cmake -DOME_LIBFUZZER=ON, clang) this file is a
+// libFuzzer target. Otherwise main() runs random inputs from a seed, or
+// replays input files such as libFuzzer crash reproducers.
+
+#include "engine/OrderBook.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using ome::AccountId;
+using ome::MassCancelRequest;
+using ome::Order;
+using ome::OrderId;
+using ome::OrderType;
+using ome::Price;
+using ome::Quantity;
+using ome::Side;
+using ome::StpMode;
+using ome::Timestamp;
+using ome::Trade;
+
+Side opposite(Side side) { return side == Side::Buy ? Side::Sell : Side::Buy; }
+
+bool isStop(OrderType type) { return type == OrderType::Stop || type == OrderType::StopLimit; }
+
+struct Failure {
+    std::string what;
+};
+
+void check(bool ok, const std::string& what) {
+    if (!ok) throw Failure{what};
+}
+
+// The book's rules restated as plainly as possible: nothing here is indexed,
+// so every lookup scans, and "earlier in the queue" is a smaller seq. Slow and
+// easy to check by reading, which is the point.
+class ReferenceBook {
+public:
+    struct RefOrder {
+        OrderId id;
+        Side side;
+        OrderType type;
+        Price price;
+        Price stopPrice;
+        AccountId account;
+        StpMode stpMode;
+        Quantity shown;         // Displayed open quantity
+        Quantity hidden;        // Iceberg reserve
+        Quantity display;       // Slice size, 0 = all shown
+        Timestamp timestamp;
+        uint64_t seq = 0;       // Queue position: lower is earlier
+    };
+
+    void setTime(Timestamp t) { now = t; }
+
+    std::vector<Trade> addOrder(const Order& order) {
+        std::vector<Trade> trades;
+        if (find(resting, order.id) || find(stops, order.id)) return trades; // Duplicate id
+
+        RefOrder o{order.id, order.side, order.type, order.price, order.stopPrice, order.account,
+                   order.stpMode, order.remainingQuantity, 0, order.displayQuantity, now};
+        if (auction) {
+            // Nothing matches during the call; market orders cannot rest
+            if (o.type == OrderType::Limit) rest(o);
+            else if (isStop(o.type)) addStop(o);
+            return trades;
+        }
+        if (isStop(o.type)) {
+            if (!triggered(o)) {
+                addStop(o);
+                return trades;
+            }
+            convertTriggered(o);
+        }
+        execute(o, trades);
+        processTriggers(trades);
+        return trades;
+    }
+
+    bool cancelOrder(OrderId id) {
+        return erase(resting, id) || erase(stops, id);
+    }
+
+    bool modifyOrder(OrderId id, Price newPrice, Quantity newQuantity, std::vector<Trade>& trades) {
+        RefOrder* found = find(resting, id);
+        if (!found) return false;
+        if (newQuantity == 0) {
+            erase(resting, id);
+            return true;
+        }
+        RefOrder& o = *found;
+        if (newPrice == o.price) {
+            if (newQuantity > o.shown + o.hidden) {
+                // Growing loses time priority
+                o.shown = newQuantity;
+                o.hidden = 0;
+                hideReserve(o);
+                o.timestamp = now;
+                o.seq = nextSeq++;
+            } else {
+                // Shrinking takes from the reserve first
+                o.shown = std::min(o.shown, newQuantity);
+                o.hidden = newQuantity - o.shown;
+            }
+        } else {
+            // A new price is a new aggressor that keeps its id
+            RefOrder moved = o;
+            erase(resting, id);
+            moved.price = newPrice;
+            moved.timestamp = now;
+            moved.shown = newQuantity;
+            moved.hidden = 0;
+            if (!auction) match(moved, trades);
+            if (moved.shown > 0) rest(moved);
+        }
+        if (!auction) processTriggers(trades);
+        return true;
+    }
+
+    size_t massCancel(const MassCancelRequest& request) {
+        // Orders without an account belong to no one
+        if (request.account == ome::kNoAccount) return 0;
+        auto selected = [&request](const RefOrder& o) {
+            const Price price = isStop(o.type) ? o.stopPrice : o.price;
+            return o.account == request.account && (!request.side || o.side == *request.side) &&
+                   price >= request.minPrice && price <= request.maxPrice;
+        };
+        size_t count = 0;
+        for (auto* orders : {&resting, &stops}) {
+            auto end = std::remove_if(orders->begin(), orders->end(), selected);
+            count += static_cast<size_t>(std::distance(end, orders->end()));
+            orders->erase(end, orders->end());
+        }
+        return count;
+    }
+
+    void startAuction() { auction = true; }
+
+    // All crossing volume, iceberg reserves included, trades at the one
+    // price, best bid against best ask. Of each pair the earlier order is the
+    // maker and the later one acts as the aggressor for self-trade
+    // prevention. STP can cancel volume the price counted on and leave the
+    // book crossed; what is left clears in another round at its own price.
+    std::vector<Trade> uncross() {
+        std::vector<Trade> trades;
+        if (!auction) return trades;
+        auction = false;
+        while (auto result = equilibrium()) {
+            Quantity traded = 0;
+            bool prevented = false;
+            while (true) {
+                RefOrder* bid = best(Side::Buy);
+                RefOrder* ask = best(Side::Sell);
+                if (!bid || !ask || bid->price < result->price || ask->price > result->price) break;
+
+                const bool askIsMaker = ask->timestamp < bid->timestamp ||
+                                        (ask->timestamp == bid->timestamp && ask->id < bid->id);
+                RefOrder& maker = askIsMaker ? *ask : *bid;
+                RefOrder& taker = askIsMaker ? *bid : *ask;
+                const OrderId makerId = maker.id;
+                const OrderId takerId = taker.id;
+                const Quantity qty = std::min(bid->shown, ask->shown);
+                if (maker.account != ome::kNoAccount && maker.account == taker.account) {
+                    prevented = true;
+                    switch (taker.stpMode) {
+                    case StpMode::CancelNewest:
+                        erase(resting, takerId);
+                        break;
+                    case StpMode::CancelOldest:
+                        erase(resting, makerId);
+                        break;
+                    case StpMode::CancelBoth:
+                        erase(resting, takerId);
+                        erase(resting, makerId);
+                        break;
+                    case StpMode::Decrement:
+                        maker.shown -= qty;
+                        taker.shown -= qty;
+                        settle(makerId);
+                        settle(takerId);
+                        break;
+                    }
+                    continue;
+                }
+
+                trades.push_back({result->price, qty, makerId, takerId, now});
+                traded += qty;
+                maker.shown -= qty;
+                taker.shown -= qty;
+                settle(makerId);
+                settle(takerId);
+            }
+            // Without STP the round executes exactly the volume it was priced on
+            check(prevented || traded == result->volume, "uncross round traded " + std::to_string(traded) +
+                                                             " of " + std::to_string(result->volume));
+        }
+        processTriggers(trades);
+        return trades;
+    }
+
+    std::optional<Price> bestPrice(Side side) const {
+        const RefOrder* o = best(side);
+        return o ? std::optional<Price>(o->price) : std::nullopt;
+    }
+
+    // Displayed quantity per price, best first
+    std::vector<ome::LevelInfo> depth(Side side) const {
+        std::vector<ome::LevelInfo> levels;
+        for (const RefOrder* o : queue(side)) {
+            if (levels.empty() || levels.back().price != o->price) levels.push_back({o->price, 0});
+            levels.back().quantity += o->shown;
+        }
+        return levels;
+    }
+
+    // Resting orders in priority order (bids, then asks), then pending stops
+    // in trigger order: the order of OrderBook::visitOrders
+    std::vector<const RefOrder*> orders() const {
+        std::vector<const RefOrder*> all = queue(Side::Buy);
+        for (const RefOrder* o : queue(Side::Sell)) all.push_back(o);
+        for (const RefOrder* o : stopQueue()) all.push_back(o);
+        return all;
+    }
+
+    // Every id a cancel or modify could hit
+    std::vector<OrderId> liveIds() const {
+        std::vector<OrderId> ids;
+        for (const RefOrder& o : resting) ids.push_back(o.id);
+        for (const RefOrder& o : stops) ids.push_back(o.id);
+        return ids;
+    }
+
+    // During the call: the price that executes the most open volume,
+    // then leaves the least imbalance; among equals, the one nearest the last
+    // trade (or the middle of them). Every resting price is tried.
+    std::optional<ome::AuctionInfo> indicative() const { return auction ? equilibrium() : std::nullopt; }
+
+    std::optional<Price> lastTradePrice() const { return lastTrade; }
+    bool inAuction() const { return auction; }
+    size_t orderCount() const { return resting.size() + stops.size(); }
+
+private:
+    static RefOrder* find(std::vector<RefOrder>& orders, OrderId id) {
+        for (RefOrder& o : orders) {
+            if (o.id == id) return &o;
+        }
+        return nullptr;
+    }
+
+    static bool erase(std::vector<RefOrder>& orders, OrderId id) {
+        for (auto it = orders.begin(); it != orders.end(); ++it) {
+            if (it->id == id) {
+                orders.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void hideReserve(RefOrder& o) {
+        if (o.display > 0 && o.shown > o.display) {
+            o.hidden += o.shown - o.display;
+            o.shown = o.display;
+        }
+    }
+
+    static bool better(Side side, const RefOrder& a, const RefOrder& b) {
+        if (a.price != b.price) return side == Side::Buy ? a.price > b.price : a.price < b.price;
+        return a.seq < b.seq;
+    }
+
+    std::vector<const RefOrder*> queue(Side side) const {
+        std::vector<const RefOrder*> orders;
+        for (const RefOrder& o : resting) {
+            if (o.side == side) orders.push_back(&o);
+        }
+        std::sort(orders.begin(), orders.end(),
+                  [side](const RefOrder* a, const RefOrder* b) { return better(side, *a, *b); });
+        return orders;
+    }
+
+    // Buy stops fire lowest first, then sell stops highest first; FIFO within
+    // a stop price
+    std::vector<const RefOrder*> stopQueue() const {
+        std::vector<const RefOrder*> all;
+        for (Side side : {Side::Buy, Side::Sell}) {
+            std::vector<const RefOrder*> pending;
+            for (const RefOrder& o : stops) {
+                if (o.side == side) pending.push_back(&o);
+            }
+            std::sort(pending.begin(), pending.end(), [side](const RefOrder* a, const RefOrder* b) {
+                if (a->stopPrice != b->stopPrice) {
+                    return side == Side::Buy ? a->stopPrice < b->stopPrice : a->stopPrice > b->stopPrice;
+                }
+                return a->seq < b->seq;
+            });
+            all.insert(all.end(), pending.begin(), pending.end());
+        }
+        return all;
+    }
+
+    RefOrder* best(Side side) {
+        RefOrder* top = nullptr;
+        for (RefOrder& o : resting) {
+            if (o.side == side && (!top || better(side, o, *top))) top = &o;
+        }
+        return top;
+    }
+    const RefOrder* best(Side side) const { return const_cast<ReferenceBook*>(this)->best(side); }
+
+    void rest(RefOrder o) {
+        hideReserve(o);
+        o.seq = nextSeq++;
+        resting.push_back(o);
+    }
+
+    void addStop(RefOrder o) {
+        o.seq = nextSeq++;
+        stops.push_back(o);
+    }
+
+    // A maker whose displayed size ran out shows its next slice at the back of
+    // the queue, or leaves the book
+    void settle(OrderId id) {
+        RefOrder& o = *find(resting, id);
+        if (o.shown > 0) return;
+        if (o.hidden == 0) {
+            erase(resting, id);
+            return;
+        }
+        o.shown = std::min(o.display, o.hidden);
+        o.hidden -= o.shown;
+        o.timestamp = now;
+        o.seq = nextSeq++;
+    }
+
+    void match(RefOrder& aggressor, std::vector<Trade>& trades) {
+        while (aggressor.shown > 0) {
+            RefOrder* maker = best(opposite(aggressor.side));
+            if (!maker) break;
+            const bool crosses = aggressor.type == OrderType::Market ||
+                                 (aggressor.side == Side::Buy ? aggressor.price >= maker->price
+                                                              : aggressor.price <= maker->price);
+            if (!crosses) break;
+
+            const OrderId makerId = maker->id;
+            const Quantity qty = std::min(aggressor.shown, maker->shown);
+            if (aggressor.account != ome::kNoAccount && maker->account == aggressor.account) {
+                switch (aggressor.stpMode) {
+                case StpMode::CancelNewest:
+                    aggressor.shown = 0;
+                    break;
+                case StpMode::CancelOldest:
+                    erase(resting, makerId);
+                    break;
+                case StpMode::CancelBoth:
+                    aggressor.shown = 0;
+                    erase(resting, makerId);
+                    break;
+                case StpMode::Decrement:
+                    aggressor.shown -= qty;
+                    maker->shown -= qty;
+                    settle(makerId);
+                    break;
+                }
+                continue;
+            }
+
+            trades.push_back({maker->price, qty, makerId, aggressor.id, now});
+            aggressor.shown -= qty;
+            maker->shown -= qty;
+            settle(makerId);
+        }
+    }
+
+    void execute(RefOrder o, std::vector<Trade>& trades) {
+        if (!auction) match(o, trades);
+        if (o.shown > 0 && o.type != OrderType::Market) rest(o);
+    }
+
+    bool triggered(const RefOrder& stop) const {
+        if (!lastTrade) return false;
+        return stop.side == Side::Buy ? *lastTrade >= stop.stopPrice : *lastTrade <= stop.stopPrice;
+    }
+
+    void convertTriggered(RefOrder& o) const {
+        o.type = (o.type == OrderType::Stop) ? OrderType::Market : OrderType::Limit;
+        o.timestamp = now;
+    }
+
+    // Each new trade moves the last price; stops it reaches join a work list
+    // in trigger order and run in turn, possibly trading and triggering more.
+    void processTriggers(std::vector<Trade>& trades) {
+        std::vector<RefOrder> work;
+        size_t next = 0;
+        size_t seen = 0;
+        while (true) {
+            if (trades.size() > seen) {
+                seen = trades.size();
+                lastTrade = trades.back().price;
+                std::vector<OrderId> fired;
+                for (const RefOrder* o : stopQueue()) {
+                    if (triggered(*o)) fired.push_back(o->id);
+                }
+                for (OrderId id : fired) {
+                    RefOrder o = *find(stops, id);
+                    erase(stops, id);
+                    convertTriggered(o);
+                    work.push_back(o);
+                }
+            }
+            if (next == work.size()) break;
+            execute(work[next++], trades);
+        }
+    }
+
+    std::optional<ome::AuctionInfo> equilibrium() const {
+        if (!best(Side::Buy) || !best(Side::Sell)) return std::nullopt;
+        Quantity bestVolume = 0;
+        Quantity bestImbalance = 0;
+        Price lo = 0, hi = 0;
+        std::vector<Price> prices;
+        for (const RefOrder& o : resting) prices.push_back(o.price);
+        std::sort(prices.begin(), prices.end());
+        prices.erase(std::unique(prices.begin(), prices.end()), prices.end());
+        for (Price p : prices) {
+            Quantity buy = 0, sell = 0;
+            for (const RefOrder& o : resting) {
+                if (o.side == Side::Buy && o.price >= p) buy += o.shown + o.hidden;
+                if (o.side == Side::Sell && o.price <= p) sell += o.shown + o.hidden;
+            }
+            const Quantity volume = std::min(buy, sell);
+            const Quantity imbalance = buy > sell ? buy - sell : sell - buy;
+            if (volume == 0) continue;
+            if (volume > bestVolume || (volume == bestVolume && imbalance < bestImbalance)) {
+                bestVolume = volume;
+                bestImbalance = imbalance;
+                lo = hi = p;
+            } else if (volume == bestVolume && imbalance == bestImbalance) {
+                hi = p;
+            }
+        }
+        if (bestVolume == 0) return std::nullopt;
+        const Price price = lastTrade ? std::clamp(*lastTrade, lo, hi) : lo + (hi - lo) / 2;
+        return ome::AuctionInfo{price, bestVolume};
+    }
+
+    std::vector<RefOrder> resting;
+    std::vector<RefOrder> stops;
+    std::optional<Price> lastTrade;
+    bool auction = false;
+    uint64_t nextSeq = 1;
+    Timestamp now{};
+};
+
+// Reads the fuzzer's bytes as bounded choices; past the end every read is 0
+class Input {
+public:
+    Input(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    bool empty() const { return pos >= size; }
+    uint8_t byte() { return pos < size ? data[pos++] : 0; }
+    // In [0, n), n <= 256
+    uint64_t below(uint64_t n) { return byte() % n; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+};
+
+// Prices sit in a narrow band so orders cross, queue and trigger often
+constexpr Price kLowPrice = 90;
+constexpr uint64_t kPriceBand = 21;
+constexpr size_t kMaxAccounts = 4;      // Including kNoAccount
+
+class Harness {
+public:
+    // Applies one decoded step to both books and compares them. `current`
+    // describes the step, for failure messages.
+    void step(Input& in) {
+        time += in.below(2);    // Equal timestamps exercise the uncross tie-break
+        const Timestamp now{std::chrono::microseconds(time)};
+        book.setTime(now);
+        reference.setTime(now);
+
+        std::ostringstream what;
+        auto describeAs = [&what, this] { current = what.str(); };
+        std::vector<Trade> got;
+        std::vector<Trade> expected;
+        const uint8_t op = in.byte() % 64;
+        if (op < 36) {
+            Order order = makeOrder(in);
+            what << "add id=" << order.id << ' ' << sideName(order.side) << " type=" << static_cast<int>(order.type)
+                 << " price=" << order.price << " stop=" << order.stopPrice << " qty=" << order.remainingQuantity
+                 << " display=" << order.displayQuantity << " account=" << order.account
+                 << " stp=" << static_cast<int>(order.stpMode);
+            describeAs();
+            if (!book.hasOrder(order.id)) accounts[order.id] = order.account;
+            got = book.addOrder(order);
+            expected = reference.addOrder(order);
+        } else if (op < 46 || (op >= 58 && op < 60)) {
+            const OrderId id = pickId(in);
+            const bool expire = op >= 58;
+            what << (expire ? "expire id=" : "cancel id=") << id;
+            describeAs();
+            const bool bookResult = expire ? book.expireOrder(id) : book.cancelOrder(id);
+            check(bookResult == reference.cancelOrder(id), "cancel result");
+        } else if (op < 56) {
+            const OrderId id = pickId(in);
+            const Price price = kLowPrice + in.below(kPriceBand);
+            const Quantity qty = in.below(8) == 0 ? 0 : 1 + in.below(40);
+            what << "modify id=" << id << " price=" << price << " qty=" << qty;
+            describeAs();
+            const bool bookResult = book.modifyOrder(id, price, qty, got);
+            check(bookResult == reference.modifyOrder(id, price, qty, expected), "modify result");
+        } else if (op < 58) {
+            MassCancelRequest request;
+            request.account = in.below(kMaxAccounts);
+            const uint64_t side = in.below(3);
+            if (side < 2) request.side = side == 0 ? Side::Buy : Side::Sell;
+            if (in.below(2)) {
+                request.minPrice = kLowPrice + in.below(kPriceBand);
+                request.maxPrice = request.minPrice + in.below(kPriceBand);
+            }
+            what << "massCancel account=" << request.account << " side="
+                 << (request.side ? sideName(*request.side) : "any") << " band=" << request.minPrice << '-'
+                 << request.maxPrice;
+            describeAs();
+            check(book.massCancel(request) == reference.massCancel(request), "mass cancel count");
+        } else if (op == 60) {
+            what << "startAuction";
+            describeAs();
+            book.startAuction();
+            reference.startAuction();
+        } else {
+            what << "uncross";
+            describeAs();
+            got = book.uncross();
+            expected = reference.uncross();
+        }
+
+        checkInvariants(got);
+        compareTrades(got, expected);
+        compareState();
+        ++steps;
+        tradeCount += got.size();
+    }
+
+    std::string current;
+    uint64_t steps = 0;
+    uint64_t tradeCount = 0;
+
+private:
+    static const char* sideName(Side side) { return side == Side::Buy ? "buy" : "sell"; }
+
+    // Mostly a live order; otherwise any id ever handed out, or one never used
+    OrderId pickId(Input& in) {
+        const std::vector<OrderId> live = reference.liveIds();
+        const uint8_t choice = in.byte();
+        if (!live.empty() && choice % 4 != 0) return live[in.byte() % live.size()];
+        return 1 + in.byte() % (nextId + 1);
+    }
+
+    Order makeOrder(Input& in) {
+        // Now and then reuse an id, which the book must reject while it is live
+        const OrderId id = in.below(16) == 0 ? pickId(in) : nextId++;
+        const Side side = in.below(2) ? Side::Sell : Side::Buy;
+        Order order(id, side, kLowPrice + in.below(kPriceBand), 1 + in.below(40));
+        const uint64_t type = in.below(16);
+        order.type = type < 11 ? OrderType::Limit
+                   : type < 13 ? OrderType::Market
+                   : type < 15 ? OrderType::Stop
+                               : OrderType::StopLimit;
+        if (isStop(order.type)) order.stopPrice = kLowPrice + in.below(kPriceBand);
+        if (in.below(4) == 0) order.displayQuantity = 1 + in.below(8);
+        order.account = in.below(kMaxAccounts);
+        order.stpMode = static_cast<StpMode>(in.below(4));
+        return order;
+    }
+
+    // Properties of the book alone, so they hold even where the reference
+    // shares a mistake
+    void checkInvariants(const std::vector<Trade>& trades) {
+        const auto bid = book.bestBid();
+        const auto ask = book.bestAsk();
+        if (!book.inAuction() && bid && ask) {
+            check(*bid < *ask, "book crossed outside an auction: " + std::to_string(*bid) + " >= " +
+                                   std::to_string(*ask));
+        }
+        for (const Trade& t : trades) {
+            const AccountId account = accounts[t.makerOrderId];
+            check(account == ome::kNoAccount || account != accounts[t.takerOrderId],
+                  "self-trade: " + describe(t) + " account=" + std::to_string(account));
+        }
+    }
+
+    static void compareTrades(const std::vector<Trade>& got, const std::vector<Trade>& expected) {
+        check(got.size() == expected.size(),
+              "trade count " + std::to_string(got.size()) + " != " + std::to_string(expected.size()));
+        for (size_t i = 0; i < got.size(); ++i) {
+            const Trade& a = got[i];
+            const Trade& b = expected[i];
+            check(a.price == b.price && a.quantity == b.quantity && a.makerOrderId == b.makerOrderId &&
+                      a.takerOrderId == b.takerOrderId && a.timestamp == b.timestamp,
+                  "trade " + std::to_string(i) + ": " + describe(a) + " != " + describe(b));
+        }
+    }
+
+    static std::string describe(const Trade& t) {
+        return std::to_string(t.quantity) + "@" + std::to_string(t.price) + " maker=" +
+               std::to_string(t.makerOrderId) + " taker=" + std::to_string(t.takerOrderId);
+    }
+
+    void compareState() {
+        check(book.bestBid() == reference.bestPrice(Side::Buy), "best bid");
+        check(book.bestAsk() == reference.bestPrice(Side::Sell), "best ask");
+
+        auto compareDepth = [](const std::vector<ome::LevelInfo>& got, const std::vector<ome::LevelInfo>& expected,
+                               const char* side) {
+            check(got.size() == expected.size(), std::string(side) + " level count");
+            for (size_t i = 0; i < got.size(); ++i) {
+                check(got[i].price == expected[i].price && got[i].quantity == expected[i].quantity,
+                      std::string(side) + " level " + std::to_string(i) + ": " + std::to_string(got[i].quantity) +
+                          "@" + std::to_string(got[i].price) + " != " + std::to_string(expected[i].quantity) + "@" +
+                          std::to_string(expected[i].price));
+            }
+        };
+        compareDepth(book.getBids(), reference.depth(Side::Buy), "bid");
+        compareDepth(book.getAsks(), reference.depth(Side::Sell), "ask");
+
+        // Queue order within each level is where priority bugs show first
+        const auto expected = reference.orders();
+        size_t index = 0;
+        book.visitOrders([&](const Order& o) {
+            check(index < expected.size(), "extra order " + std::to_string(o.id));
+            const auto& r = *expected[index];
+            check(o.id == r.id && o.side == r.side && o.type == r.type && o.price == r.price &&
+                      o.stopPrice == r.stopPrice && o.remainingQuantity == r.shown &&
+                      o.hiddenQuantity == r.hidden && o.timestamp == r.timestamp,
+                  "order " + std::to_string(index) + ": id " + std::to_string(o.id) + " shown " +
+                      std::to_string(o.remainingQuantity) + "+" + std::to_string(o.hiddenQuantity) + " at " +
+                      std::to_string(o.timestamp.time_since_epoch().count()) + " != id " +
+                      std::to_string(r.id) + " shown " + std::to_string(r.shown) + "+" + std::to_string(r.hidden) +
+                      " at " + std::to_string(r.timestamp.time_since_epoch().count()));
+            ++index;
+        });
+        check(index == expected.size(), "missing orders");
+        check(book.orderCount() == reference.orderCount(), "order count");
+
+        check(book.getLastTradePrice() == reference.lastTradePrice(), "last trade price");
+        check(book.inAuction() == reference.inAuction(), "auction state");
+        const auto got = book.getIndicative();
+        const auto want = reference.indicative();
+        check(got.has_value() == want.has_value() &&
+                  (!got || (got->price == want->price && got->volume == want->volume)),
+              "indicative uncross");
+        check(book.stateHash() == book.recomputeStateHash(), "state hash out of step with the book");
+    }
+
+    ome::OrderBook book;
+    ReferenceBook reference;
+    std::unordered_map<OrderId, AccountId> accounts;    // Of the live order with each id
+    OrderId nextId = 1;
+    uint64_t time = 1;
+};
+
+// Runs one input to the end; on a mismatch prints the steps leading to it
+bool runInput(const uint8_t* data, size_t size, Harness& harness) {
+    constexpr size_t kShownSteps = 20;
+    Input in(data, size);
+    std::vector<std::string> history;
+    while (!in.empty()) {
+        try {
+            harness.step(in);
+            history.push_back(harness.current);
+        } catch (const Failure& failure) {
+            history.push_back(harness.current);
+            std::cerr << "Mismatch after step " << history.size() - 1 << ": " << failure.what << "\n";
+            const size_t from = history.size() > kShownSteps ? history.size() - kShownSteps : 0;
+            for (size_t i = from; i < history.size(); ++i) {
+                std::cerr << "  step " << i << ": " << history[i] << "\n";
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+#ifdef OME_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    Harness harness;
+    if (!runInput(data, size, harness)) std::abort();
+    return 0;
+}
+
+#else
+
+namespace {
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--seed N] [--runs N] [--steps N] [INPUT_FILE...]\n"
+              << "  Without files, runs --runs random inputs of about --steps steps each\n"
+              << "  (defaults 1000 and 2000) from --seed (default 1). With files, replays\n"
+              << "  each one, e.g. a libFuzzer crash reproducer.\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t seed = 1;
+    uint64_t runs = 1000;
+    uint64_t stepsPerRun = 2000;
+    std::vector<std::string> files;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--seed" && i + 1 < argc) {
+                seed = std::stoull(argv[++i]);
+            } else if (arg == "--runs" && i + 1 < argc) {
+                runs = std::stoull(argv[++i]);
+            } else if (arg == "--steps" && i + 1 < argc) {
+                stepsPerRun = std::stoull(argv[++i]);
+            } else if (arg.rfind("--", 0) != 0) {
+                files.push_back(arg);
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!files.empty()) {
+        for (const auto& path : files) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                std::cerr << "Cannot open " << path << std::endl;
+                return 1;
+            }
+            std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            Harness harness;
+            if (!runInput(bytes.data(), bytes.size(), harness)) {
+                std::cerr << "Failed: " << path << std::endl;
+                return 1;
+            }
+            std::cout << path << ": " << harness.steps << " steps, " << harness.tradeCount << " trades, ok\n";
+        }
+        return 0;
+    }
+
+    // Steps read 8 bytes on average; a short tail just ends the run
+    constexpr size_t kBytesPerStep = 8;
+    uint64_t steps = 0;
+    uint64_t trades = 0;
+    for (uint64_t run = 0; run < runs; ++run) {
+        std::mt19937_64 rng(seed + run);
+        std::vector<uint8_t> bytes(stepsPerRun * kBytesPerStep);
+        for (auto& b : bytes) b = static_cast<uint8_t>(rng());
+        Harness harness;
+        if (!runInput(bytes.data(), bytes.size(), harness)) {
+            std::cerr << "Failed: reproduce with --seed " << seed + run << " --runs 1 --steps " << stepsPerRun
+                      << std::endl;
+            return 1;
+        }
+        steps += harness.steps;
+        trades += harness.tradeCount;
+    }
+    std::cout << runs << " runs, " << steps << " steps, " << trades << " trades, no mismatches\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,263 @@
+// ome_gen: synthetic order flow from WorkloadGenerator, either written as
+// command files in journal format (for ome_replay) or sent live to running
+// servers over WebSocket.
+//
+// The engine runs one book per process, so each symbol gets its own output
+// file (PATH.<symbol> when there is more than one) or its own server URL.
+
+#include "workload/WorkloadGenerator.hpp"
+#include "workload/JsonMessage.hpp"
+#include "persistence/CommandCodec.hpp"
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using WSClient = websocketpp::client<websocketpp::config::asio_client>;
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " (--out PATH | --ws URL [--ws URL ...] [--connections N] [--speed X])\n"
+              << "  [--count N | --duration SECONDS] [--seed N] [--symbols N] [--accounts N]\n"
+              << "  [--rate PER_SECOND] [--arrival poisson|bursty] [--burst-multiplier X]\n"
+              << "  [--burst-seconds S] [--calm-seconds S] [--cancel-ratio R] [--modify-ratio R]\n"
+              << "  [--market-ratio R] [--marketable-ratio R] [--mid PRICE] [--ticks-from-touch X]\n"
+              << "  [--size-median Q] [--size-sigma X] [--lot Q]" << std::endl;
+}
+
+// Command files, one per symbol, sequenced from 1
+int writeFiles(ome::WorkloadGenerator& generator, const std::string& path, uint32_t symbols,
+               uint64_t count, ome::Timestamp::duration duration) {
+    std::vector<std::ofstream> files;
+    std::vector<std::vector<char>> buffers(symbols);
+    std::vector<uint64_t> sequences(symbols, 0);
+    for (uint32_t i = 0; i < symbols; ++i) {
+        files.emplace_back(symbols == 1 ? path : path + "." + std::to_string(i), std::ios::binary | std::ios::trunc);
+        if (!files.back()) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+    }
+
+    uint64_t written = 0;
+    ome::Timestamp first{};
+    for (; count == 0 || written < count; ++written) {
+        ome::WorkloadEvent event = generator.next();
+        if (written == 0) first = event.time;
+        if (duration.count() && event.time - first >= duration) break;
+
+        auto& buffer = buffers[event.symbol];
+        ome::CommandCodec::encode(++sequences[event.symbol], event.time, event.command, buffer);
+        if (buffer.size() >= (1u << 20)) {
+            files[event.symbol].write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    for (uint32_t i = 0; i < symbols; ++i) {
+        files[i].write(buffers[i].data(), static_cast<std::streamsize>(buffers[i].size()));
+        if (!files[i].flush()) {
+            std::cerr << "Write failed for symbol " << i << std::endl;
+            return 1;
+        }
+    }
+    std::cerr << "Wrote " << written << " commands for " << symbols << " symbol(s)" << std::endl;
+    return 0;
+}
+
+// Live mode: `connections` sessions per URL, symbol i to URL i % urls. An
+// order and everything that names it use the same session, since client
+// order ids are per connection. speed scales the generated timeline
+// (2 = twice as fast); 0 sends as fast as possible.
+int sendLive(ome::WorkloadGenerator& generator, const std::vector<std::string>& urls, uint32_t connections,
+             double speed, uint64_t count, ome::Timestamp::duration duration) {
+    WSClient client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+
+    std::atomic<uint32_t> opened{0};
+    std::atomic<bool> failed{false};
+    std::atomic<uint64_t> execs{0};
+    std::atomic<uint64_t> rejects{0};
+    client.set_open_handler([&opened](websocketpp::connection_hdl) { ++opened; });
+    client.set_fail_handler([&failed](websocketpp::connection_hdl) { failed = true; });
+    client.set_message_handler([&](websocketpp::connection_hdl, WSClient::message_ptr msg) {
+        const std::string& payload = msg->get_payload();
+        if (payload.find("\"type\":\"exec\"") != std::string::npos) {
+            ++execs;
+        } else if (payload.find("\"type\":\"reject\"") != std::string::npos) {
+            ++rejects;
+        }
+    });
+
+    // sessions[url * connections + n]
+    std::vector<websocketpp::connection_hdl> sessions;
+    for (const auto& url : urls) {
+        for (uint32_t n = 0; n < connections; ++n) {
+            websocketpp::lib::error_code ec;
+            WSClient::connection_ptr con = client.get_connection(url, ec);
+            if (ec) {
+                std::cerr << "Cannot connect to " << url << ": " << ec.message() << std::endl;
+                return 1;
+            }
+            client.connect(con);
+            sessions.push_back(con->get_handle());
+        }
+    }
+    std::thread io([&client] { client.run(); });
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (opened < sessions.size() && !failed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (opened < sessions.size()) {
+        std::cerr << "Could not open all " << sessions.size() << " connections" << std::endl;
+        client.stop();
+        io.join();
+        return 1;
+    }
+
+    uint64_t sent = 0;
+    ome::Timestamp first{};
+    const auto wallStart = std::chrono::steady_clock::now();
+    for (; count == 0 || sent < count; ++sent) {
+        ome::WorkloadEvent event = generator.next();
+        if (sent == 0) first = event.time;
+        if (duration.count() && event.time - first >= duration) break;
+
+        if (speed > 0) {
+            auto offset = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(std::chrono::duration<double>(event.time - first).count() / speed));
+            std::this_thread::sleep_until(wallStart + offset);
+        }
+
+        ome::OrderId id = event.command.order ? event.command.order->id : *event.command.orderId;
+        size_t session = (event.symbol % urls.size()) * connections + id % connections;
+        websocketpp::lib::error_code ec;
+        client.send(sessions[session], toJsonMessage(event), websocketpp::frame::opcode::text, ec);
+        if (ec) {
+            std::cerr << "Send failed: " << ec.message() << std::endl;
+            break;
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    // Let the last acks arrive
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    for (auto& hdl : sessions) {
+        websocketpp::lib::error_code ec;
+        client.close(hdl, websocketpp::close::status::normal, "done", ec);
+    }
+    io.join();
+
+    std::cerr << "Sent " << sent << " messages in " << elapsed << " s ("
+              << static_cast<double>(sent) / elapsed << "/s); " << execs << " execution reports, "
+              << rejects << " rejects" << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ome::WorkloadConfig config;
+    std::string outPath;
+    std::vector<std::string> urls;
+    uint32_t connections = 1;
+    double speed = 1.0;
+    uint64_t count = 0;
+    double durationSeconds = 0;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--out") {
+                outPath = value;
+            } else if (arg == "--ws") {
+                urls.push_back(value);
+            } else if (arg == "--connections") {
+                connections = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+            } else if (arg == "--speed") {
+                speed = std::stod(value);
+            } else if (arg == "--count") {
+                count = std::stoull(value);
+            } else if (arg == "--duration") {
+                durationSeconds = std::stod(value);
+            } else if (arg == "--seed") {
+                config.seed = std::stoull(value);
+            } else if (arg == "--symbols") {
+                config.symbols = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+            } else if (arg == "--accounts") {
+                config.accounts = static_cast<uint32_t>(std::stoul(value));
+            } else if (arg == "--rate") {
+                config.ratePerSecond = std::stod(value);
+            } else if (arg == "--arrival") {
+                config.arrival = value == "bursty" ? ome::ArrivalProcess::Bursty : ome::ArrivalProcess::Poisson;
+            } else if (arg == "--burst-multiplier") {
+                config.burstMultiplier = std::stod(value);
+            } else if (arg == "--burst-seconds") {
+                config.meanBurstSeconds = std::stod(value);
+            } else if (arg == "--calm-seconds") {
+                config.meanCalmSeconds = std::stod(value);
+            } else if (arg == "--cancel-ratio") {
+                config.cancelRatio = std::stod(value);
+            } else if (arg == "--modify-ratio") {
+                config.modifyRatio = std::stod(value);
+            } else if (arg == "--market-ratio") {
+                config.marketRatio = std::stod(value);
+            } else if (arg == "--marketable-ratio") {
+                config.marketableRatio = std::stod(value);
+            } else if (arg == "--mid") {
+                config.initialMid = std::stoull(value);
+            } else if (arg == "--ticks-from-touch") {
+                config.meanTicksFromTouch = std::stod(value);
+            } else if (arg == "--size-median") {
+                config.sizeMedian = std::stod(value);
+            } else if (arg == "--size-sigma") {
+                config.sizeSigma = std::stod(value);
+            } else if (arg == "--lot") {
+                config.lotSize = std::stoull(value);
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (outPath.empty() == urls.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (count == 0 && durationSeconds <= 0) {
+        count = outPath.empty() ? 100'000 : 1'000'000;
+    }
+
+    // A fixed start keeps files identical across runs; live mode only uses
+    // the offsets between events
+    ome::WorkloadGenerator generator(config);
+    auto duration = std::chrono::duration_cast<ome::Timestamp::duration>(
+        std::chrono::duration<double>(durationSeconds));
+
+    try {
+        if (!outPath.empty()) {
+            return writeFiles(generator, outPath, config.symbols, count, duration);
+        }
+        return sendLive(generator, urls, connections, speed, count, duration);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
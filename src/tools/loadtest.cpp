@@ -0,0 +1,466 @@
+// ome_loadtest: drives a running ome over many WebSocket sessions at a fixed
+// intended rate and reports request latency and server throughput.
+//
+// Request k is scheduled for start + k / rate. Its latency runs from that
+// intended time to the first reply (ack or reject), as well as from the moment
+// it actually went out. A client that sends late because the server, or its
+// own window of outstanding requests, held it back would otherwise leave the
+// wait out of every sample taken meanwhile (coordinated omission); measured
+// from the schedule, the stall is charged the way a client arriving on time
+// would see it. An order's own fills (those that follow its ack directly) are
+// timed from the add or modify that placed it.
+
+#include "workload/WorkloadGenerator.hpp"
+#include "workload/JsonMessage.hpp"
+#include "common/Latency.hpp"
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using WSClient = websocketpp::client<websocketpp::config::asio_client>;
+
+struct Options {
+    std::string url = "ws://localhost:8080";
+    uint32_t sessions = 100;
+    uint32_t threads = 2;
+    double rate = 10'000;           // Requests per second, all sessions
+    double durationSeconds = 10;
+    uint32_t window = 16;           // Outstanding requests per session
+    double drainSeconds = 2;
+    ome::WorkloadConfig workload;
+};
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--url URL] [--sessions N] [--threads N] [--rate PER_SECOND]\n"
+              << "  [--duration SECONDS] [--window N] [--drain SECONDS] [--seed N] [--accounts N]\n"
+              << "  [--cancel-ratio R] [--modify-ratio R] [--market-ratio R] [--marketable-ratio R]\n"
+              << "  [--mid PRICE]" << std::endl;
+}
+
+struct Request {
+    ome::Command::Type type;
+    Clock::time_point intended;
+    Clock::time_point sent;
+};
+
+struct OrderState {
+    std::deque<Request> pending;    // Awaiting their first reply, in send order
+    Request placement{};            // Latest add or modify, for timing own fills
+    ome::OrderId engineId = 0;
+    bool closed = false;
+};
+
+struct Session {
+    websocketpp::connection_hdl hdl;
+    std::unordered_map<std::string, OrderState> orders;    // By clOrdId
+    std::unordered_map<ome::OrderId, std::string> byEngineId;
+    size_t outstanding = 0;
+    std::string aggressor;          // Just acked: fills that follow directly are its own
+    bool open = true;               // Until the server closes it (e.g. throttle strikes)
+};
+
+struct LatencyPair {
+    std::unique_ptr<ome::LatencyHistogram> corrected = std::make_unique<ome::LatencyHistogram>();
+    std::unique_ptr<ome::LatencyHistogram> raw = std::make_unique<ome::LatencyHistogram>();
+
+    void record(const Request& request, Clock::time_point now) {
+        corrected->record(static_cast<uint64_t>((now - request.intended).count()));
+        raw->record(static_cast<uint64_t>((now - request.sent).count()));
+    }
+};
+
+// One endpoint and io thread per worker; each owns every threads-th session.
+// The sender thread and the io thread share the sessions under `mutex`.
+struct Worker {
+    WSClient client;
+    std::thread io;
+    std::vector<Session> sessions;
+    std::map<websocketpp::connection_hdl, size_t, std::owner_less<websocketpp::connection_hdl>> byHdl;
+    std::atomic<uint32_t> opened{0};
+    std::atomic<bool> failed{false};
+
+    std::mutex mutex;
+    std::condition_variable windowCv;
+    LatencyPair acks;
+    LatencyPair fills;
+    uint64_t ackCount = 0;
+    uint64_t fillCount = 0;
+    uint64_t rejectCount = 0;
+    uint64_t skipped = 0;           // Sends for sessions already closed
+    Clock::time_point lastReply{};
+};
+
+// Whether `exec` answers a request of this type (anything else is unsolicited,
+// e.g. the cancel of a market order's unfilled remainder)
+bool answers(ome::Command::Type type, const std::string& exec) {
+    if (exec == "rejected") return true;
+    switch (type) {
+    case ome::Command::Add:    return exec == "new";
+    case ome::Command::Cancel: return exec == "canceled";
+    case ome::Command::Modify: return exec == "replaced" || exec == "canceled";
+    default:                   return false;
+    }
+}
+
+void complete(Worker& w, Session& session, OrderState& order, Clock::time_point now) {
+    w.acks.record(order.pending.front(), now);
+    order.pending.pop_front();
+    ++w.ackCount;
+    --session.outstanding;
+    w.lastReply = now;
+    w.windowCv.notify_all();
+}
+
+void forgetIfDone(Session& session, const std::string& clOrdId) {
+    auto it = session.orders.find(clOrdId);
+    if (it == session.orders.end() || !it->second.closed || !it->second.pending.empty()) return;
+    if (it->second.engineId) session.byEngineId.erase(it->second.engineId);
+    session.orders.erase(it);
+}
+
+void onReply(Worker& w, size_t index, const std::string& payload) {
+    const Clock::time_point now = Clock::now();
+    // Book and trade broadcasts go to every session; only replies are parsed.
+    // A taker's reports arrive together, while trades are broadcast before
+    // the reports of the command that made them, so a broadcast ends any run
+    // of own fills (a later fill of the order is some other taker's).
+    const bool exec = payload.find("\"type\":\"exec\"") != std::string::npos;
+    if (!exec && payload.find("\"type\":\"reject\"") == std::string::npos) {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.sessions[index].aggressor.clear();
+        return;
+    }
+
+    json j;
+    try {
+        j = json::parse(payload);
+    } catch (const std::exception&) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(w.mutex);
+    Session& session = w.sessions[index];
+    std::string clOrdId = j.value("clOrdId", std::string());
+    if (clOrdId.empty() && j.contains("orderId")) {
+        auto it = session.byEngineId.find(j["orderId"].get<ome::OrderId>());
+        if (it != session.byEngineId.end()) clOrdId = it->second;
+    }
+    auto orderIt = session.orders.find(clOrdId);
+
+    if (!exec) {
+        ++w.rejectCount;
+        session.aggressor.clear();
+        if (orderIt != session.orders.end() && !orderIt->second.pending.empty()) {
+            OrderState& order = orderIt->second;
+            // A refused add never existed; an unknown id is already gone
+            if (order.pending.front().type == ome::Command::Add ||
+                j.value("reason", std::string()) == "unknown_cl_ord_id") {
+                order.closed = true;
+            }
+            complete(w, session, order, now);
+            forgetIfDone(session, clOrdId);
+        }
+        return;
+    }
+    if (orderIt == session.orders.end()) return;
+    OrderState& order = orderIt->second;
+
+    const std::string type = j.value("exec", std::string());
+    if (type == "new" && j.contains("orderId")) {
+        order.engineId = j["orderId"].get<ome::OrderId>();
+        session.byEngineId[order.engineId] = clOrdId;
+    }
+    if (type == "partial_fill" || type == "fill") {
+        if (session.aggressor == clOrdId) {
+            w.fills.record(order.placement, now);
+            ++w.fillCount;
+        }
+    } else {
+        session.aggressor.clear();
+        if (!order.pending.empty() && answers(order.pending.front().type, type)) {
+            const bool placed = order.pending.front().type != ome::Command::Cancel;
+            complete(w, session, order, now);
+            if (placed && type != "rejected" && type != "canceled") session.aggressor = clOrdId;
+        }
+    }
+    if (j.value("leavesQty", uint64_t{1}) == 0 || type == "rejected") {
+        order.closed = true;
+        forgetIfDone(session, clOrdId);
+    }
+}
+
+void printLatency(const char* title, const LatencyPair& pair) {
+    std::printf("%-24s %9s %9s %9s %9s %9s %9s %10s\n", title, "p50", "p90", "p99", "p99.9", "p99.99", "max", "count");
+    auto row = [](const char* name, const ome::LatencyHistogram& h) {
+        auto us = [&h](double q) { return static_cast<double>(h.quantile(q)) / 1000.0; };
+        std::printf("  %-22s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10llu\n", name, us(0.5), us(0.9), us(0.99),
+                    us(0.999), us(0.9999), us(1.0), static_cast<unsigned long long>(h.count()));
+    };
+    row("corrected", *pair.corrected);
+    row("uncorrected", *pair.raw);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--url") {
+                options.url = value;
+            } else if (arg == "--sessions") {
+                options.sessions = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+            } else if (arg == "--threads") {
+                options.threads = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+            } else if (arg == "--rate") {
+                options.rate = std::stod(value);
+            } else if (arg == "--duration") {
+                options.durationSeconds = std::stod(value);
+            } else if (arg == "--window") {
+                options.window = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+            } else if (arg == "--drain") {
+                options.drainSeconds = std::stod(value);
+            } else if (arg == "--seed") {
+                options.workload.seed = std::stoull(value);
+            } else if (arg == "--accounts") {
+                options.workload.accounts = static_cast<uint32_t>(std::stoul(value));
+            } else if (arg == "--cancel-ratio") {
+                options.workload.cancelRatio = std::stod(value);
+            } else if (arg == "--modify-ratio") {
+                options.workload.modifyRatio = std::stod(value);
+            } else if (arg == "--market-ratio") {
+                options.workload.marketRatio = std::stod(value);
+            } else if (arg == "--marketable-ratio") {
+                options.workload.marketableRatio = std::stod(value);
+            } else if (arg == "--mid") {
+                options.workload.initialMid = std::stoull(value);
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (options.rate <= 0 || options.durationSeconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    options.threads = std::min(options.threads, options.sessions);
+
+    // Connect: session s lives on worker s % threads
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (uint32_t t = 0; t < options.threads; ++t) {
+        auto worker = std::make_unique<Worker>();
+        Worker* w = worker.get();
+        w->client.clear_access_channels(websocketpp::log::alevel::all);
+        w->client.clear_error_channels(websocketpp::log::elevel::all);
+        w->client.init_asio();
+        w->client.set_open_handler([w](websocketpp::connection_hdl) { ++w->opened; });
+        w->client.set_fail_handler([w](websocketpp::connection_hdl) { w->failed = true; });
+        w->client.set_close_handler([w](websocketpp::connection_hdl hdl) {
+            auto it = w->byHdl.find(hdl);
+            if (it == w->byHdl.end()) return;
+            std::lock_guard<std::mutex> lock(w->mutex);
+            w->sessions[it->second].open = false;
+            w->windowCv.notify_all();
+        });
+        w->client.set_message_handler([w](websocketpp::connection_hdl hdl, WSClient::message_ptr msg) {
+            auto it = w->byHdl.find(hdl);
+            if (it != w->byHdl.end()) onReply(*w, it->second, msg->get_payload());
+        });
+
+        for (uint32_t s = t; s < options.sessions; s += options.threads) {
+            websocketpp::lib::error_code ec;
+            WSClient::connection_ptr con = w->client.get_connection(options.url, ec);
+            if (ec) {
+                std::cerr << "Cannot connect to " << options.url << ": " << ec.message() << std::endl;
+                return 1;
+            }
+            w->client.connect(con);
+            w->byHdl[con->get_handle()] = w->sessions.size();
+            w->sessions.push_back(Session{con->get_handle(), {}, {}, 0, {}, true});
+        }
+        workers.push_back(std::move(worker));
+    }
+    // byHdl is complete before any handler can run
+    for (auto& w : workers) {
+        Worker* raw = w.get();
+        raw->io = std::thread([raw] { raw->client.run(); });
+    }
+
+    auto shutdown = [&workers] {
+        for (auto& w : workers) {
+            for (auto& session : w->sessions) {
+                websocketpp::lib::error_code ec;
+                w->client.close(session.hdl, websocketpp::close::status::normal, "done", ec);
+            }
+        }
+        for (auto& w : workers) {
+            if (w->io.joinable()) w->io.join();
+        }
+    };
+
+    const auto connectDeadline = Clock::now() + std::chrono::seconds(10);
+    auto allOpen = [&workers] {
+        for (auto& w : workers) {
+            if (w->opened < w->sessions.size()) return false;
+        }
+        return true;
+    };
+    while (!allOpen() && Clock::now() < connectDeadline) {
+        bool failed = false;
+        for (auto& w : workers) failed |= w->failed.load();
+        if (failed) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!allOpen()) {
+        std::cerr << "Could not open all " << options.sessions << " sessions" << std::endl;
+        for (auto& w : workers) w->client.stop();
+        for (auto& w : workers) w->io.join();
+        return 1;
+    }
+
+    // Open loop on a fixed schedule; a session with a full window holds the
+    // sender back, and the wait shows up in the corrected latencies
+    ome::WorkloadGenerator generator(options.workload);
+    const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rate));
+    const uint64_t total = static_cast<uint64_t>(options.rate * options.durationSeconds);
+    const Clock::time_point start = Clock::now();
+    Clock::duration maxLag{0};
+    uint64_t sent = 0;
+
+    for (; sent < total; ++sent) {
+        const Clock::time_point intended = start + interval * static_cast<int64_t>(sent);
+        ome::WorkloadEvent event = generator.next();
+        const ome::OrderId id = event.command.order ? event.command.order->id : *event.command.orderId;
+        const uint32_t global = static_cast<uint32_t>(id % options.sessions);
+        Worker& w = *workers[global % options.threads];
+        const size_t index = global / options.threads;
+        const std::string message = ome::toJsonMessage(event);
+        const std::string clOrdId = std::to_string(id);
+
+        // Sleep most of the way, then spin for the last stretch
+        auto now = Clock::now();
+        if (intended - now > std::chrono::microseconds(100)) {
+            std::this_thread::sleep_until(intended - std::chrono::microseconds(50));
+        }
+        while (Clock::now() < intended) {
+        }
+
+        websocketpp::connection_hdl hdl;
+        {
+            std::unique_lock<std::mutex> lock(w.mutex);
+            Session& session = w.sessions[index];
+            w.windowCv.wait(lock, [&] { return session.outstanding < options.window || !session.open; });
+            if (!session.open) {
+                ++w.skipped;
+                continue;
+            }
+            now = Clock::now();
+            maxLag = std::max(maxLag, now - intended);
+            OrderState& order = session.orders[clOrdId];
+            Request request{event.command.type, intended, now};
+            order.pending.push_back(request);
+            if (event.command.type != ome::Command::Cancel) order.placement = request;
+            ++session.outstanding;
+            hdl = session.hdl;
+        }
+
+        websocketpp::lib::error_code ec;
+        w.client.send(hdl, message, websocketpp::frame::opcode::text, ec);
+        if (ec) {
+            std::cerr << "Send failed: " << ec.message() << std::endl;
+            break;
+        }
+    }
+    const Clock::time_point sendEnd = Clock::now();
+
+    // Wait for the replies still in flight
+    const auto drainDeadline = sendEnd + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.drainSeconds));
+    uint64_t unanswered = 0;
+    uint64_t skipped = 0;
+    for (auto& w : workers) {
+        std::unique_lock<std::mutex> lock(w->mutex);
+        w->windowCv.wait_until(lock, drainDeadline, [&w] {
+            for (const auto& session : w->sessions) {
+                if (session.open && session.outstanding) return false;
+            }
+            return true;
+        });
+        for (const auto& session : w->sessions) unanswered += session.outstanding;
+        skipped += w->skipped;
+    }
+    shutdown();
+
+    // Merge and report
+    LatencyPair acks;
+    LatencyPair fills;
+    uint64_t ackCount = 0;
+    uint64_t fillCount = 0;
+    uint64_t rejectCount = 0;
+    Clock::time_point lastReply = start;
+    for (auto& w : workers) {
+        acks.corrected->merge(*w->acks.corrected);
+        acks.raw->merge(*w->acks.raw);
+        fills.corrected->merge(*w->fills.corrected);
+        fills.raw->merge(*w->fills.raw);
+        ackCount += w->ackCount;
+        fillCount += w->fillCount;
+        rejectCount += w->rejectCount;
+        lastReply = std::max(lastReply, w->lastReply);
+    }
+
+    const double sendSeconds = std::chrono::duration<double>(sendEnd - start).count();
+    const double replySeconds = std::chrono::duration<double>(lastReply - start).count();
+    const double lagMs = std::chrono::duration<double, std::milli>(maxLag).count();
+    std::printf("target        %s, %u sessions on %u threads, window %u\n", options.url.c_str(),
+                options.sessions, options.threads, options.window);
+    std::printf("intended      %.0f req/s for %.1f s (%llu requests)\n", options.rate, options.durationSeconds,
+                static_cast<unsigned long long>(total));
+    std::printf("sent          %llu in %.2f s (%.0f req/s), at worst %.1f ms behind schedule\n",
+                static_cast<unsigned long long>(sent - skipped), sendSeconds,
+                static_cast<double>(sent - skipped) / sendSeconds, lagMs);
+    if (skipped) {
+        std::printf("skipped       %llu requests for sessions the server closed\n",
+                    static_cast<unsigned long long>(skipped));
+    }
+    std::printf("replies       %llu acks (%.0f/s) incl. %llu rejects, %llu own fills, %llu unanswered\n",
+                static_cast<unsigned long long>(ackCount), replySeconds > 0 ? static_cast<double>(ackCount) / replySeconds : 0.0,
+                static_cast<unsigned long long>(rejectCount), static_cast<unsigned long long>(fillCount),
+                static_cast<unsigned long long>(unanswered));
+    if (sendSeconds > options.durationSeconds * 1.01) {
+        std::printf("saturated     the schedule was not kept; the ack rate above is the server's throughput\n");
+    }
+    std::printf("\n");
+    printLatency("ack latency (us)", acks);
+    printLatency("own fill latency (us)", fills);
+    return unanswered || skipped ? 2 : 0;
+}
@@ -0,0 +1,179 @@
+// ome_replay: feeds a recorded command file (journal format) straight into
+// the matching engine on this thread, with no server and no queue, to
+// reproduce a session and to benchmark the matcher on real flow.
+//
+// Every command runs at its recorded timestamp on a SimulatedClock, so the
+// trades produced are the same on every run and every machine.
+
+#include "engine/MatchingEngine.hpp"
+#include "persistence/Journal.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " COMMAND_FILE [--snapshot PATH]"
+              << " [--record-trades PATH] [--expect-trades PATH]" << std::endl;
+}
+
+// One line per fill: timestamp (ns), price, quantity, maker id, taker id
+std::string formatTrade(const ome::Trade& trade) {
+    char line[128];
+    std::snprintf(line, sizeof(line), "%" PRId64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64,
+                  static_cast<int64_t>(trade.timestamp.time_since_epoch().count()),
+                  static_cast<uint64_t>(trade.price), static_cast<uint64_t>(trade.quantity),
+                  static_cast<uint64_t>(trade.makerOrderId), static_cast<uint64_t>(trade.takerOrderId));
+    return line;
+}
+
+bool recordTrades(const std::string& path, const std::vector<ome::Trade>& trades) {
+    std::ofstream out(path, std::ios::trunc);
+    for (const auto& trade : trades) {
+        out << formatTrade(trade) << '\n';
+    }
+    return static_cast<bool>(out.flush());
+}
+
+// Reports the first divergence; true if the files agree line for line
+bool diffTrades(const std::string& path, const std::vector<ome::Trade>& trades) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+
+    std::string expected;
+    size_t index = 0;
+    for (; index < trades.size(); ++index) {
+        if (!std::getline(in, expected)) {
+            std::cerr << "Trade " << index << ": produced " << formatTrade(trades[index])
+                      << ", expected file ends after " << index << " trades" << std::endl;
+            return false;
+        }
+        std::string produced = formatTrade(trades[index]);
+        if (produced != expected) {
+            std::cerr << "Trade " << index << ": produced " << produced
+                      << ", expected " << expected << std::endl;
+            return false;
+        }
+    }
+    if (std::getline(in, expected)) {
+        std::cerr << "Trade " << index << ": expected " << expected
+                  << ", replay produced only " << index << " trades" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Nearest-rank percentile of sorted samples
+uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string commandPath;
+    std::string snapshotPath;
+    std::string recordPath;
+    std::string expectPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if (arg == "--record-trades" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--expect-trades" && i + 1 < argc) {
+            expectPath = argv[++i];
+        } else if (commandPath.empty() && arg.rfind("--", 0) != 0) {
+            commandPath = arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (commandPath.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        auto clock = std::make_shared<ome::SimulatedClock>();
+        ome::MatchingEngine engine(clock);
+
+        std::vector<ome::Trade> trades;
+        engine.setTradeCallback([&trades](const std::vector<ome::Trade>& fills) {
+            trades.insert(trades.end(), fills.begin(), fills.end());
+        });
+
+        uint64_t startSequence = 0;
+        if (!snapshotPath.empty()) {
+            auto restored = engine.restoreSnapshot(snapshotPath);
+            if (!restored) {
+                std::cerr << "Cannot load snapshot " << snapshotPath << std::endl;
+                return 1;
+            }
+            startSequence = *restored;
+        }
+
+        // Decode everything up front so the timed loop is matching only
+        std::vector<ome::JournalRecord> records;
+        ome::Journal::replay(commandPath, [&records](ome::JournalRecord& record) {
+            records.push_back(std::move(record));
+        }, nullptr, startSequence);
+        if (records.empty()) {
+            std::cerr << "No commands in " << commandPath << std::endl;
+            return 1;
+        }
+        trades.reserve(records.size());
+
+        std::vector<uint64_t> latencies;
+        latencies.reserve(records.size());
+        auto started = SteadyClock::now();
+        for (const auto& record : records) {
+            clock->set(record.timestamp);
+            auto before = SteadyClock::now();
+            engine.recover(record);
+            latencies.push_back(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(SteadyClock::now() - before).count()));
+        }
+        auto elapsed = std::chrono::duration<double>(SteadyClock::now() - started).count();
+
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("commands     %zu (sequence %" PRIu64 "-%" PRIu64 ")\n", records.size(),
+                    records.front().sequence, records.back().sequence);
+        std::printf("trades       %zu\n", trades.size());
+        std::printf("resting      %zu orders\n", engine.getOrderBook().orderCount());
+        std::printf("elapsed      %.3f s\n", elapsed);
+        std::printf("throughput   %.0f commands/s\n", static_cast<double>(records.size()) / elapsed);
+        std::printf("latency ns   p50 %" PRIu64 "  p90 %" PRIu64 "  p99 %" PRIu64 "  p99.9 %" PRIu64 "  max %" PRIu64 "\n",
+                    percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+                    percentile(latencies, 99.9), latencies.back());
+
+        if (!recordPath.empty() && !recordTrades(recordPath, trades)) {
+            std::cerr << "Cannot write " << recordPath << std::endl;
+            return 1;
+        }
+        if (!expectPath.empty()) {
+            if (!diffTrades(expectPath, trades)) return 2;
+            std::printf("trades match %s\n", expectPath.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "JsonMessage.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace ome {
+
+std::string toJsonMessage(const WorkloadEvent& event) {
+    const Command& cmd = event.command;
+    json j;
+    switch (cmd.type) {
+    case Command::Add: {
+        const Order& order = *cmd.order;
+        j = {
+            {"type", "add"},
+            {"side", order.side == Side::Buy ? "buy" : "sell"},
+            {"price", order.price},
+            {"qty", order.initialQuantity},
+            {"clOrdId", std::to_string(order.id)},
+            {"account", order.account}
+        };
+        if (order.type == OrderType::Market) j["orderType"] = "market";
+        break;
+    }
+    case Command::Cancel:
+        j = {{"type", "cancel"}, {"clOrdId", std::to_string(*cmd.orderId)}, {"account", event.account}};
+        break;
+    case Command::Modify:
+        j = {
+            {"type", "modify"},
+            {"clOrdId", std::to_string(*cmd.orderId)},
+            {"price", cmd.price},
+            {"qty", cmd.quantity},
+            {"account", event.account}
+        };
+        break;
+    default:
+        break;
+    }
+    return j.dump();
+}
+
+} // namespace ome
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "WorkloadGenerator.hpp"
+#include <string>
+
+namespace ome {
+
+// The server's JSON request for a generated event. Orders use their
+// generated id as clOrdId (unique per run), and cancels and modifies name
+// the order by it, so every message for an order must go over the
+// connection that added it.
+std::string toJsonMessage(const WorkloadEvent& event);
+
+} // namespace ome
@@ -0,0 +1,209 @@
+#include "WorkloadGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace ome {
+
+namespace {
+
+Timestamp::duration seconds(double s) {
+    return std::chrono::duration_cast<Timestamp::duration>(std::chrono::duration<double>(s));
+}
+
+} // namespace
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& config)
+    : config(config), rng(config.seed) {
+    for (uint32_t i = 0; i < std::max<uint32_t>(config.symbols, 1); ++i) {
+        auto state = std::make_unique<SymbolState>();
+        SymbolState* raw = state.get();
+        raw->book.setOrderClosedCallback([raw](const Order& order) {
+            auto it = raw->liveIndex.find(order.id);
+            if (it == raw->liveIndex.end()) return; // Never rested
+            size_t slot = it->second;
+            raw->liveIndex.erase(it);
+            if (slot != raw->live.size() - 1) {
+                raw->live[slot] = raw->live.back();
+                raw->liveIndex[raw->live[slot].id] = slot;
+            }
+            raw->live.pop_back();
+        });
+        raw->nextArrival = config.start;
+        raw->regimeEnds = config.start + seconds(exponential(config.meanCalmSeconds));
+        scheduleArrival(*raw);
+        symbols.push_back(std::move(state));
+    }
+}
+
+double WorkloadGenerator::uniform() {
+    return static_cast<double>(rng() >> 11) * 0x1.0p-53;
+}
+
+double WorkloadGenerator::exponential(double mean) {
+    return -mean * std::log1p(-uniform());
+}
+
+uint64_t WorkloadGenerator::geometric(double mean) {
+    if (mean <= 0) return 0;
+    const double p = 1.0 / (1.0 + mean);
+    return static_cast<uint64_t>(std::floor(std::log1p(-uniform()) / std::log1p(-p)));
+}
+
+double WorkloadGenerator::normal() {
+    // Box-Muller; 1 - u keeps the log argument in (0, 1]
+    const double u1 = 1.0 - uniform();
+    const double u2 = uniform();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * std::numbers::pi * u2);
+}
+
+void WorkloadGenerator::scheduleArrival(SymbolState& state) {
+    if (config.arrival == ArrivalProcess::Poisson) {
+        state.nextArrival += seconds(exponential(1.0 / config.ratePerSecond));
+        return;
+    }
+
+    // Exponential gaps are memoryless, so a gap that runs past the end of
+    // the current period is simply redrawn at the next period's rate
+    Timestamp t = state.nextArrival;
+    while (true) {
+        double rate = config.ratePerSecond * (state.bursting ? config.burstMultiplier : 1.0);
+        Timestamp arrival = t + seconds(exponential(1.0 / rate));
+        if (arrival < state.regimeEnds) {
+            state.nextArrival = arrival;
+            return;
+        }
+        t = state.regimeEnds;
+        state.bursting = !state.bursting;
+        state.regimeEnds = t + seconds(exponential(state.bursting ? config.meanBurstSeconds
+                                                                  : config.meanCalmSeconds));
+    }
+}
+
+WorkloadEvent WorkloadGenerator::next() {
+    uint32_t symbol = 0;
+    for (uint32_t i = 1; i < symbols.size(); ++i) {
+        if (symbols[i]->nextArrival < symbols[symbol]->nextArrival) symbol = i;
+    }
+    SymbolState& state = *symbols[symbol];
+    const Timestamp time = state.nextArrival;
+
+    const double u = uniform();
+    Command cmd{Command::Add, std::nullopt, std::nullopt};
+    AccountId account;
+    if (!state.live.empty() && u < config.cancelRatio + config.modifyRatio) {
+        const LiveOrder target = state.live[rng() % state.live.size()];
+        account = target.account;
+        if (u < config.cancelRatio) {
+            cmd = {Command::Cancel, std::nullopt, target.id};
+        } else {
+            // Re-quote at a fresh passive price and size
+            cmd = {Command::Modify, std::nullopt, target.id};
+            cmd.price = passivePrice(state, target.side);
+            cmd.quantity = makeSize();
+        }
+    } else {
+        cmd = makeAdd(state);
+        if (u >= config.cancelRatio + config.modifyRatio &&
+            u < config.cancelRatio + config.modifyRatio + config.marketRatio) {
+            cmd.order->type = OrderType::Market;
+            cmd.order->price = 0;
+        }
+        account = cmd.order->account;
+    }
+
+    state.book.setTime(time);
+    apply(state, cmd);
+    scheduleArrival(state);
+    return {symbol, time, account, std::move(cmd)};
+}
+
+Command WorkloadGenerator::makeAdd(SymbolState& state) {
+    Side side = uniform() < 0.5 ? Side::Buy : Side::Sell;
+    Price price = uniform() < config.marketableRatio ? marketablePrice(state, side)
+                                                     : passivePrice(state, side);
+    Order order(nextOrderId++, side, price, makeSize());
+    order.account = 1 + rng() % std::max<uint32_t>(config.accounts, 1);
+    return {Command::Add, order, std::nullopt};
+}
+
+Price WorkloadGenerator::touch(const SymbolState& state, Side side) const {
+    const Price tick = config.tickSize;
+    const Price spread = std::max<Price>(config.initialSpreadTicks, 1) * tick;
+    auto bid = state.book.bestBid();
+    auto ask = state.book.bestAsk();
+    if (side == Side::Buy) {
+        if (bid) return *bid;
+        if (ask) return *ask > spread ? *ask - spread : tick;
+        return config.initialMid > spread / 2 + tick ? config.initialMid - spread / 2 : tick;
+    }
+    if (ask) return *ask;
+    if (bid) return *bid + spread;
+    return config.initialMid + (spread + 1) / 2;
+}
+
+Price WorkloadGenerator::passivePrice(const SymbolState& state, Side side) {
+    const Price tick = config.tickSize;
+    const Price own = touch(state, side);
+    auto bid = state.book.bestBid();
+    auto ask = state.book.bestAsk();
+
+    // A wide spread is sometimes narrowed by a tick; otherwise join or
+    // queue behind the touch
+    Price price;
+    if (bid && ask && *ask - *bid > tick && uniform() < 0.25) {
+        price = side == Side::Buy ? own + tick : own - tick;
+    } else {
+        Price behind = geometric(config.meanTicksFromTouch) * tick;
+        price = side == Side::Buy ? (own > behind ? own - behind : tick) : own + behind;
+    }
+
+    // Never cross: marketable orders are generated on purpose elsewhere
+    if (side == Side::Buy && ask && price >= *ask) price = *ask - tick;
+    if (side == Side::Sell && bid && price <= *bid) price = *bid + tick;
+    return std::max(price, tick);
+}
+
+Price WorkloadGenerator::marketablePrice(const SymbolState& state, Side side) {
+    const Price tick = config.tickSize;
+    const Price opposite = touch(state, side == Side::Buy ? Side::Sell : Side::Buy);
+    Price through = geometric(config.meanTicksFromTouch) * tick;
+    Price price = side == Side::Buy ? opposite + through : (opposite > through ? opposite - through : tick);
+    return std::max(price, tick);
+}
+
+Quantity WorkloadGenerator::makeSize() {
+    double size = config.sizeMedian;
+    if (config.sizeSigma > 0) {
+        size = std::exp(std::log(config.sizeMedian) + config.sizeSigma * normal());
+    }
+    const Quantity lot = std::max<Quantity>(config.lotSize, 1);
+    Quantity lots = std::max<Quantity>(1, static_cast<Quantity>(std::llround(size / static_cast<double>(lot))));
+    return std::min(lots * lot, std::max(config.maxSize, lot));
+}
+
+void WorkloadGenerator::apply(SymbolState& state, const Command& cmd) {
+    switch (cmd.type) {
+    case Command::Add: {
+        const Order& order = *cmd.order;
+        state.book.addOrder(order);
+        if (state.book.hasOrder(order.id)) {
+            state.liveIndex[order.id] = state.live.size();
+            state.live.push_back({order.id, order.side, order.account});
+        }
+        break;
+    }
+    case Command::Cancel:
+        state.book.cancelOrder(*cmd.orderId);
+        break;
+    case Command::Modify: {
+        std::vector<Trade> trades;
+        state.book.modifyOrder(*cmd.orderId, cmd.price, cmd.quantity, trades);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+} // namespace ome
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "engine/Command.hpp"
+#include "engine/OrderBook.hpp"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace ome {
+
+enum class ArrivalProcess {
+    Poisson,    // Exponential gaps at ratePerSecond
+    Bursty      // Poisson whose rate switches between calm and burst periods
+};
+
+struct WorkloadConfig {
+    uint64_t seed = 1;
+    uint32_t symbols = 1;               // Independent books, one stream each
+    uint32_t accounts = 100;
+    Timestamp start{};
+
+    // Arrivals, per symbol
+    ArrivalProcess arrival = ArrivalProcess::Poisson;
+    double ratePerSecond = 10'000;      // Bursty: the calm rate
+    double burstMultiplier = 10;        // Bursty: burst rate / calm rate
+    double meanBurstSeconds = 0.05;     // Bursty: exponential period lengths
+    double meanCalmSeconds = 1.0;
+
+    // Event mix. Cancels and modifies pick a random live order of the
+    // symbol; with none live, an add is generated instead.
+    double cancelRatio = 0.40;
+    double modifyRatio = 0.10;
+    double marketRatio = 0.02;
+    double marketableRatio = 0.05;      // Limit orders priced through the touch
+
+    // Prices in ticks. Passive orders sit a geometric number of ticks behind
+    // their own side's touch; marketable ones that many through the other.
+    Price initialMid = 10'000;
+    Price tickSize = 1;
+    double meanTicksFromTouch = 2.0;
+    Price initialSpreadTicks = 2;       // Used while a side of the book is empty
+
+    // Sizes: log-normal around the median, in whole lots (sigma 0: fixed)
+    double sizeMedian = 100;
+    double sizeSigma = 0.8;
+    Quantity lotSize = 1;
+    Quantity maxSize = 100'000;
+};
+
+struct WorkloadEvent {
+    uint32_t symbol;
+    Timestamp time;
+    AccountId account;  // Owner of the order the command adds or names
+    Command command;
+};
+
+// Seedable synthetic order flow. Each symbol keeps a shadow OrderBook fed
+// with its own events, so prices are placed against the real touch and
+// cancels/modifies only name orders that are still live; the same seed and
+// config always give the same stream. Distributions are computed from the
+// raw mt19937_64 output rather than <random> distributions, whose results
+// differ between standard libraries.
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(const WorkloadConfig& config);
+
+    // Next event across all symbols, in time order. Order ids are unique
+    // across symbols and increase with time.
+    WorkloadEvent next();
+
+    const OrderBook& book(uint32_t symbol) const { return symbols[symbol]->book; }
+
+private:
+    struct LiveOrder {
+        OrderId id;
+        Side side;
+        AccountId account;
+    };
+
+    struct SymbolState {
+        OrderBook book;
+        std::vector<LiveOrder> live;                   // Random pick for cancel/modify
+        std::unordered_map<OrderId, size_t> liveIndex;
+        Timestamp nextArrival;
+        Timestamp regimeEnds;                          // Bursty: current period's end
+        bool bursting = false;
+    };
+
+    double uniform();                                  // [0, 1)
+    double exponential(double mean);
+    uint64_t geometric(double mean);                   // 0, 1, 2, ... with this mean
+    double normal();
+
+    void scheduleArrival(SymbolState& state);
+    Command makeAdd(SymbolState& state);
+    // The side's best price, or where it would be given the other side
+    Price touch(const SymbolState& state, Side side) const;
+    Price passivePrice(const SymbolState& state, Side side);
+    Price marketablePrice(const SymbolState& state, Side side);
+    Quantity makeSize();
+    void apply(SymbolState& state, const Command& cmd);
+
+    WorkloadConfig config;
+    std::mt19937_64 rng;
+    std::vector<std::unique_ptr<SymbolState>> symbols;
+    OrderId nextOrderId = 1;
+};
+
+} // namespace ome